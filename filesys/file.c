@@ -1,6 +1,7 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 
 /* An open file. */
@@ -8,6 +9,7 @@ struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	int ref_cnt;                /* Holders; see file_share(). */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -20,6 +22,7 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
 		return file;
 	} else {
 		inode_close (inode);
@@ -48,10 +51,34 @@ file_duplicate (struct file *file) {
 	return nfile;
 }
 
+/* Adds a holder to FILE and returns it.  Each holder closes FILE
+ * once, and only the last close releases it.  Holders share FILE's
+ * position, so they must not use it while others remain; see
+ * file_is_shared(). */
+struct file *
+file_share (struct file *file) {
+	enum intr_level old_level = intr_disable ();
+	file->ref_cnt++;
+	intr_set_level (old_level);
+	return file;
+}
+
+/* Returns true if FILE has more than one holder. */
+bool
+file_is_shared (struct file *file) {
+	return file->ref_cnt > 1;
+}
+
 /* Closes FILE. */
 void
 file_close (struct file *file) {
 	if (file != NULL) {
+		enum intr_level old_level = intr_disable ();
+		bool last = --file->ref_cnt == 0;
+		intr_set_level (old_level);
+		if (!last)
+			return;
+
 		file_allow_write (file);
 		inode_close (file->inode);
 		free (file);
@@ -86,6 +113,18 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) {
 	return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads SIZE bytes from FILE, starting at offset FILE_OFS, which
+ * must be sector-aligned, into the pages at PAGES[0], PAGES[1], and
+ * so on, PGSIZE bytes to each page.
+ * Returns the number of bytes actually read,
+ * which may be less than SIZE if end of file is reached.
+ * The file's current position is unaffected. */
+off_t
+file_read_pages (struct file *file, void *const pages[], off_t size,
+		off_t file_ofs) {
+	return inode_read_pages (file->inode, pages, size, file_ofs);
+}
+
 /* Writes SIZE bytes from BUFFER into FILE,
  * starting at the file's current position.
  * Returns the number of bytes actually written,
@@ -113,6 +152,46 @@ file_write_at (struct file *file, const void *buffer, off_t size,
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+ * position, to DST at its current position, without going through
+ * a caller's buffer.  The two must not be the same file.
+ * Returns the number of bytes actually copied,
+ * which may be less than SIZE if the end of either file is reached.
+ * Advances both files' positions by the number of bytes copied. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size) {
+	off_t bytes_copied = inode_copy (dst->inode, dst->pos, src->inode,
+			src->pos, size);
+	dst->pos += bytes_copied;
+	src->pos += bytes_copied;
+	return bytes_copied;
+}
+
+/* Copies up to SIZE bytes of DISK, starting at SECTOR, into FILE at
+ * its current position, as file_copy() does.  Advances FILE's
+ * position by the number of bytes copied and returns it. */
+off_t
+file_copy_from_disk (struct file *file, struct disk *disk,
+		disk_sector_t sector, off_t size) {
+	off_t bytes_copied = inode_copy_from_disk (file->inode, file->pos, disk,
+			sector, size);
+	file->pos += bytes_copied;
+	return bytes_copied;
+}
+
+/* Copies up to SIZE bytes of FILE, starting at its current position,
+ * to DISK from SECTOR on, padding the last sector with zeros, as
+ * file_copy() does.  Advances FILE's position by the number of bytes
+ * copied and returns it. */
+off_t
+file_copy_to_disk (struct disk *disk, disk_sector_t sector,
+		struct file *file, off_t size) {
+	off_t bytes_copied = inode_copy_to_disk (disk, sector, file->inode,
+			file->pos, size);
+	file->pos += bytes_copied;
+	return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 void
@@ -6,6 +6,15 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/exec_cache.h"
+#endif
+#ifdef VM
+#include "filesys/page_cache.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -33,6 +42,8 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	unsigned generation;                /* Advanced by writes and removal. */
+	int cached_cnt;                     /* Pages of it in the page cache. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -53,10 +64,15 @@ byte_to_sector (const struct inode *inode, off_t pos) {
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache for in-memory inodes. */
+static struct slab_cache *inode_slab;
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	inode_slab = slab_cache_create ("inode", sizeof (struct inode), NULL);
+	ASSERT (inode_slab != NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -115,7 +131,7 @@ inode_open (disk_sector_t sector) {
 	}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = slab_alloc (inode_slab);
 	if (inode == NULL)
 		return NULL;
 
@@ -125,6 +141,8 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	inode->generation = 0;
+	inode->cached_cnt = 0;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
 }
@@ -164,7 +182,7 @@ inode_close (struct inode *inode) {
 					bytes_to_sectors (inode->data.length)); 
 		}
 
-		free (inode); 
+		slab_free (inode_slab, inode);
 	}
 }
 
@@ -174,6 +192,92 @@ void
 inode_remove (struct inode *inode) {
 	ASSERT (inode != NULL);
 	inode->removed = true;
+	inode->generation++;
+#ifdef USERPROG
+	exec_cache_invalidate (inode);
+#endif
+}
+
+/* Returns INODE's generation, which changes whenever its contents
+ * do or it is removed, so that a cache of what was read from it can
+ * tell whether it is still current. */
+unsigned
+inode_get_generation (const struct inode *inode) {
+	return inode->generation;
+}
+
+/* Returns how many of the SIZE bytes from OFFSET on lie in the page
+ * that holds OFFSET. */
+static off_t
+page_span (off_t offset, off_t size) {
+	off_t page_left = PGSIZE - offset % PGSIZE;
+	return size < page_left ? size : page_left;
+}
+
+/* Returns true if a frame of the page cache may hold part of
+ * INODE. */
+static bool
+inode_cached (const struct inode *inode) {
+	return inode->cached_cnt > 0;
+}
+
+#ifdef VM
+/* Copies the bytes of INODE from OFFSET on, up to SIZE of them and
+ * no further than the end of the page, to BUFFER if a frame of the
+ * page cache holds that page; file mappings may have changed them
+ * there since they were read.  The copy goes through CACHE, kernel
+ * memory of at least SIZE bytes, since BUFFER may be user memory;
+ * CACHE is null if BUFFER is kernel memory.  Returns the bytes copied, or 0 if no
+ * frame holds them. */
+static off_t
+cache_read (struct inode *inode, off_t offset, uint8_t *buffer, off_t size,
+		uint8_t *cache) {
+	off_t n = page_span (offset, size);
+
+	if (!page_cache_read (inode, offset, cache != NULL ? cache : buffer, n))
+		return 0;
+	if (cache != NULL)
+		memcpy (buffer, cache, n);
+	return n;
+}
+
+/* Copies the bytes at BUFFER that go to INODE from OFFSET on, up to
+ * SIZE of them and no further than the end of the page, into the
+ * frame of the page cache that holds that page, if any, through
+ * CACHE as above.  This must come before the write to disk: a
+ * writeback of the frame would otherwise put the old contents back.
+ * Returns the bytes it considered, whether a frame held them or
+ * not. */
+static off_t
+cache_write (struct inode *inode, off_t offset, const uint8_t *buffer,
+		off_t size, uint8_t *cache) {
+	off_t n = page_span (offset, size);
+
+	if (cache != NULL)
+		memcpy (cache, buffer, n);
+	page_cache_write (inode, offset, cache != NULL ? cache : buffer, n);
+	return n;
+}
+#else
+static off_t
+cache_read (struct inode *inode UNUSED, off_t offset UNUSED,
+		uint8_t *buffer UNUSED, off_t size UNUSED, uint8_t *cache UNUSED) {
+	return 0;
+}
+
+static off_t
+cache_write (struct inode *inode UNUSED, off_t offset,
+		const uint8_t *buffer UNUSED, off_t size, uint8_t *cache UNUSED) {
+	return page_span (offset, size);
+}
+#endif
+
+/* Counts CNT pages of INODE entering the page cache, or leaving it
+ * if CNT is negative.  Called with the frame table lock held. */
+void
+inode_count_cached (struct inode *inode, int cnt) {
+	inode->cached_cnt += cnt;
+	ASSERT (inode->cached_cnt >= 0);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -184,6 +288,22 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
+	uint8_t sector_cache[DISK_SECTOR_SIZE];
+	uint8_t *cache = NULL;
+	off_t cache_size = 0;
+	off_t cache_end = 0;
+
+	/* Bytes of a file that is mapped somewhere may come from the
+	 * page cache, a page at a time, or a sector at a time if no
+	 * page can be had. */
+	if (inode_cached (inode)) {
+		cache = palloc_get_page (0);
+		cache_size = PGSIZE;
+		if (cache == NULL) {
+			cache = sector_cache;
+			cache_size = DISK_SECTOR_SIZE;
+		}
+	}
 
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
@@ -197,10 +317,23 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 
 		/* Number of bytes to actually copy out of this sector. */
 		int chunk_size = size < min_left ? size : min_left;
+		off_t cached = 0;
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
+		/* Look a page up again only past what it last supplied. */
+		if (cache != NULL && offset >= cache_end) {
+			off_t span = size < inode_left ? size : inode_left;
+			cached = cache_read (inode, offset, buffer + bytes_read,
+					span < cache_size ? span : cache_size, cache);
+			cache_end = cached > 0 ? offset + cached
+				: ROUND_DOWN (offset, PGSIZE) + PGSIZE;
+		}
+
+		if (cached > 0) {
+			/* Copied from the page cache, up to the end of the page. */
+			chunk_size = cached;
+		} else if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
 			/* Read full sector directly into caller's buffer. */
 			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
 		} else {
@@ -221,24 +354,88 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		bytes_read += chunk_size;
 	}
 	free (bounce);
+	if (cache != NULL && cache != sector_cache)
+		palloc_free_page (cache);
 
 	return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
- * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+/* Reads SIZE bytes from INODE, starting at position OFFSET, which
+ * must be a multiple of DISK_SECTOR_SIZE, into PAGES[0], PAGES[1],
+ * and so on, PGSIZE bytes to each page.  Each run of consecutive
+ * sectors is read with a single disk command.  Returns the number
+ * of bytes actually read, which may be less than SIZE if an error
+ * occurs or end of file is reached. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_read_pages (struct inode *inode, void *const pages[], off_t size,
 		off_t offset) {
+	void *sectors[DISK_MULTIPLE_MAX];
+	off_t length = inode_length (inode);
+	off_t bytes_read = 0;
+
+	ASSERT (offset % DISK_SECTOR_SIZE == 0);
+	if (offset >= length)
+		return 0;
+	if (size > length - offset)
+		size = length - offset;
+
+	/* Whole sectors, in runs. */
+	while (size - bytes_read >= DISK_SECTOR_SIZE) {
+		disk_sector_t first = byte_to_sector (inode, offset + bytes_read);
+		size_t cnt = 0;
+
+		while (cnt < DISK_MULTIPLE_MAX
+				&& size - bytes_read >= DISK_SECTOR_SIZE
+				&& byte_to_sector (inode, offset + bytes_read) == first + cnt) {
+			sectors[cnt++] = (uint8_t *) pages[bytes_read / PGSIZE]
+				+ bytes_read % PGSIZE;
+			bytes_read += DISK_SECTOR_SIZE;
+		}
+		disk_read_multiple (filesys_disk, first, sectors, cnt);
+	}
+
+	/* A partial sector at end of file. */
+	if (bytes_read < size) {
+		uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
+		if (bounce == NULL)
+			return bytes_read;
+		disk_read (filesys_disk, byte_to_sector (inode, offset + bytes_read),
+				bounce);
+		memcpy ((uint8_t *) pages[bytes_read / PGSIZE] + bytes_read % PGSIZE,
+				bounce, size - bytes_read);
+		free (bounce);
+		bytes_read = size;
+	}
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+ * updating the page cache first if CACHED.  Returns the number of
+ * bytes actually written, which may be less than SIZE if end of
+ * file is reached or an error occurs.  (Normally a write at end of
+ * file would extend the inode, but growth is not yet
+ * implemented.) */
+static off_t
+inode_write (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset, bool cached) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
+	uint8_t sector_cache[DISK_SECTOR_SIZE];
+	uint8_t *cache = NULL;
+	off_t cache_size = 0;
+	off_t cache_end = 0;
 
 	if (inode->deny_write_cnt)
 		return 0;
+	if (cached && inode_cached (inode)) {
+		cache = palloc_get_page (0);
+		cache_size = PGSIZE;
+		if (cache == NULL) {
+			cache = sector_cache;
+			cache_size = DISK_SECTOR_SIZE;
+		}
+	}
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -255,6 +452,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
+		if (cache != NULL && offset >= cache_end) {
+			off_t span = size < inode_left ? size : inode_left;
+			cache_end = offset + cache_write (inode, offset,
+					buffer + bytes_written,
+					span < cache_size ? span : cache_size, cache);
+		}
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
 			/* Write full sector directly to disk. */
 			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
@@ -283,10 +486,212 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		bytes_written += chunk_size;
 	}
 	free (bounce);
+	if (cache != NULL && cache != sector_cache)
+		palloc_free_page (cache);
+	if (bytes_written > 0)
+		inode->generation++;
 
 	return bytes_written;
 }
 
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * Returns the number of bytes actually written, which may be
+ * less than SIZE if end of file is reached or an error occurs. */
+off_t
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+		off_t offset) {
+	return inode_write (inode, buffer, size, offset, true);
+}
+
+/* Writes SIZE bytes from BUFFER, a frame of the page cache that
+ * holds them, into INODE, starting at OFFSET, as inode_write_at()
+ * does but leaving the page cache alone. */
+off_t
+inode_write_back_at (struct inode *inode, const void *buffer, off_t size,
+		off_t offset) {
+	return inode_write (inode, buffer, size, offset, false);
+}
+
+/* Pages of staging memory a copy moves through at a time, halved
+ * as long as that many cannot be had. */
+#define COPY_PAGES 8
+
+/* One end of a copy: bytes of INODE from OFS on, or, if INODE is
+ * null, sectors of DISK from OFS / DISK_SECTOR_SIZE on. */
+struct copy_end {
+	struct inode *inode;
+	struct disk *disk;
+	off_t ofs;
+};
+
+/* Reads, or writes if WRITE, the CNT whole sectors of E starting at
+ * its offset, which must be a multiple of DISK_SECTOR_SIZE, from or
+ * to BUF, with one disk command per run of consecutive sectors.  The
+ * page cache is kept in step with the disk as inode_read_at() and
+ * inode_write_at() keep it. */
+static void
+copy_end_sectors (const struct copy_end *e, uint8_t *buf, size_t cnt,
+		bool write) {
+	void *sectors[COPY_PAGES * PGSIZE / DISK_SECTOR_SIZE];
+	struct disk *disk = e->inode != NULL ? filesys_disk : e->disk;
+	off_t ofs = e->ofs;
+	bool cached = e->inode != NULL && inode_cached (e->inode);
+	off_t i, len;
+
+	ASSERT (ofs % DISK_SECTOR_SIZE == 0);
+	ASSERT (cnt <= sizeof sectors / sizeof *sectors);
+	len = cnt * DISK_SECTOR_SIZE;
+	if (cached && write)
+		for (i = 0; i < len; i += cache_write (e->inode, ofs + i, buf + i,
+					len - i, NULL))
+			continue;
+
+	while (cnt > 0) {
+		disk_sector_t first = e->inode != NULL
+			? byte_to_sector (e->inode, ofs)
+			: (disk_sector_t) (ofs / DISK_SECTOR_SIZE);
+		size_t n = 0;
+
+		do {
+			sectors[n] = buf + n * DISK_SECTOR_SIZE;
+			n++;
+		} while (n < cnt && (e->inode == NULL
+					|| byte_to_sector (e->inode, ofs + n * DISK_SECTOR_SIZE)
+					== first + n));
+		if (write)
+			disk_write_multiple (disk, first, (const void *const *) sectors, n);
+		else
+			disk_read_multiple (disk, first, sectors, n);
+
+		len = n * DISK_SECTOR_SIZE;
+		if (cached && !write)
+			for (i = 0; i < len; i += page_span (ofs + i, len - i))
+				cache_read (e->inode, ofs + i, buf + i, len - i, NULL);
+		ofs += n * DISK_SECTOR_SIZE;
+		buf += n * DISK_SECTOR_SIZE;
+		cnt -= n;
+	}
+}
+
+/* Moves SIZE bytes between E and BUF, reading from E unless WRITE,
+ * and advances E past them.  Whole sectors at a sector-aligned
+ * offset go straight between BUF and the disk; the rest of an inode
+ * goes through inode_read_at() or inode_write_at(), and a partial
+ * sector of a raw disk is padded with zeros on the way out.  Returns
+ * the bytes moved. */
+static off_t
+copy_end_io (struct copy_end *e, uint8_t *buf, off_t size, bool write) {
+	off_t whole = 0, rest;
+
+	if (e->ofs % DISK_SECTOR_SIZE == 0) {
+		whole = size / DISK_SECTOR_SIZE;
+		if (e->inode == NULL && size % DISK_SECTOR_SIZE != 0) {
+			if (write)
+				memset (buf + size, 0, DISK_SECTOR_SIZE - size % DISK_SECTOR_SIZE);
+			whole++;
+		}
+		copy_end_sectors (e, buf, whole, write);
+		whole *= DISK_SECTOR_SIZE;
+		if (whole > size)
+			whole = size;
+	}
+
+	rest = 0;
+	if (whole < size)
+		rest = write
+			? inode_write_at (e->inode, buf + whole, size - whole, e->ofs + whole)
+			: inode_read_at (e->inode, buf + whole, size - whole, e->ofs + whole);
+	e->ofs += whole + rest;
+	return whole + rest;
+}
+
+/* Copies up to SIZE bytes from SRC to DST, which must not overlap,
+ * through a few pages of kernel memory instead of a caller's
+ * buffer.  Returns the bytes copied, which is less than SIZE if an
+ * inode end or a disk end is reached, DST's inode denies writes, or
+ * memory runs out. */
+static off_t
+copy (struct copy_end *dst, struct copy_end *src, off_t size) {
+	size_t pages = COPY_PAGES;
+	uint8_t *staging;
+	off_t copied = 0;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		struct copy_end *e = i == 0 ? dst : src;
+		off_t left;
+
+		if (e->inode != NULL)
+			left = inode_length (e->inode) - e->ofs;
+		else
+			left = ((off_t) disk_size (e->disk) - e->ofs / DISK_SECTOR_SIZE)
+				* DISK_SECTOR_SIZE;
+		if (size > left)
+			size = left > 0 ? left : 0;
+	}
+	if (size == 0 || (dst->inode != NULL && dst->inode->deny_write_cnt))
+		return 0;
+
+	while ((staging = palloc_get_multiple (0, pages)) == NULL && pages > 1)
+		pages /= 2;
+	if (staging == NULL)
+		return 0;
+
+	while (copied < size) {
+		off_t chunk = size - copied, n;
+
+		if (chunk > (off_t) (pages * PGSIZE))
+			chunk = pages * PGSIZE;
+		n = copy_end_io (src, staging, chunk, false);
+		n = copy_end_io (dst, staging, n, true);
+		copied += n;
+		if (n != chunk)
+			break;
+	}
+	if (dst->inode != NULL && copied > 0)
+		dst->inode->generation++;
+
+	palloc_free_multiple (staging, pages);
+	return copied;
+}
+
+/* Copies up to SIZE bytes of SRC starting at SRC_OFS to DST at
+ * DST_OFS, moving whole sectors between the disk and kernel memory
+ * as directly as it can.  The two ranges must not overlap.  Returns
+ * the bytes copied, which may be less than SIZE if the end of either
+ * inode is reached, DST denies writes, or memory runs out. */
+off_t
+inode_copy (struct inode *dst, off_t dst_ofs, struct inode *src,
+		off_t src_ofs, off_t size) {
+	struct copy_end d = { dst, NULL, dst_ofs };
+	struct copy_end s = { src, NULL, src_ofs };
+
+	return copy (&d, &s, size);
+}
+
+/* Copies up to SIZE bytes of DISK, starting at the beginning of
+ * SECTOR, to INODE at OFFSET, as inode_copy() does. */
+off_t
+inode_copy_from_disk (struct inode *inode, off_t offset, struct disk *disk,
+		disk_sector_t sector, off_t size) {
+	struct copy_end d = { inode, NULL, offset };
+	struct copy_end s = { NULL, disk, (off_t) sector * DISK_SECTOR_SIZE };
+
+	return copy (&d, &s, size);
+}
+
+/* Copies up to SIZE bytes of INODE, starting at OFFSET, to DISK from
+ * the beginning of SECTOR on, padding the last sector with zeros, as
+ * inode_copy() does. */
+off_t
+inode_copy_to_disk (struct disk *disk, disk_sector_t sector,
+		struct inode *inode, off_t offset, off_t size) {
+	struct copy_end d = { NULL, disk, (off_t) sector * DISK_SECTOR_SIZE };
+	struct copy_end s = { inode, NULL, offset };
+
+	return copy (&d, &s, size);
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 	void
@@ -306,6 +711,12 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Returns true if writes to INODE are currently denied. */
+bool
+inode_denies_write (const struct inode *inode) {
+	return inode->deny_write_cnt > 0;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
@@ -1,50 +1,142 @@
-/* page_cache.c: Implementation of Page Cache (Buffer Cache). */
+/* page_cache.c: Page cache shared by file mappings and file I/O.
+ *
+ * Every frame that holds a page of a file mapping is indexed here by
+ * the file's inode and the page's offset in it.  A process that
+ * faults on a mapped page that some frame already holds, in any
+ * process, maps that frame instead of reading the page again, so a
+ * file mapped by many processes is in memory once.  read() and
+ * write() go through the same frames: a read of a cached page copies
+ * from its frame instead of the disk, and a write updates the frame
+ * before it goes to disk, so that the mappings see it at once and a
+ * later writeback of the frame does not undo it.
+ *
+ * A frame is indexed from the time its page is loaded until it is
+ * evicted or its last mapping goes away.  The index is protected by
+ * the frame table lock (vm/vm.c), which every function here except
+ * page_cache_read() and page_cache_write() expects to be held.  Each
+ * inode counts its pages in the index, so that I/O on files that are
+ * not mapped anywhere does not look it up at all. */
 
 #include "vm/vm.h"
-static bool page_cache_readahead (struct page *page, void *kva);
-static bool page_cache_writeback (struct page *page);
-static void page_cache_destroy (struct page *page);
+#include "filesys/page_cache.h"
+#ifdef VM
+#include <hash.h>
+#include <stdio.h>
+#include "filesys/inode.h"
+#include "threads/vaddr.h"
 
-/* DO NOT MODIFY this struct */
-static const struct page_operations page_cache_op = {
-	.swap_in = page_cache_readahead,
-	.swap_out = page_cache_writeback,
-	.destroy = page_cache_destroy,
-	.type = VM_PAGE_CACHE,
-};
+/* Frames by (inode, offset). */
+static struct hash cache;
 
-tid_t page_cache_workerd;
+/* Page cache statistics. */
+static struct {
+	size_t pages;                   /* Frames indexed. */
+	size_t peak;                    /* Maximum of PAGES. */
+	unsigned long long read_hits;   /* Reads served from a frame. */
+	unsigned long long write_hits;  /* Writes that updated a frame. */
+} cache_stats;
 
-/* The initializer of file vm */
+static uint64_t
+cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry (e, struct frame, cache_elem);
+	return hash_bytes (&f->cache_inode, sizeof f->cache_inode)
+		^ hash_int (f->cache_ofs / PGSIZE);
+}
+
+static bool
+cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, cache_elem);
+	const struct frame *b = hash_entry (b_, struct frame, cache_elem);
+	if (a->cache_inode != b->cache_inode)
+		return a->cache_inode < b->cache_inode;
+	return a->cache_ofs < b->cache_ofs;
+}
+
+/* Initializes the page cache. */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+	hash_init (&cache, cache_hash, cache_less, NULL);
 }
 
-/* Initialize the page cache */
+/* Returns the frame that holds the page of INODE at OFS, which is
+ * page-aligned, or a null pointer. */
+struct frame *
+page_cache_lookup (struct inode *inode, off_t ofs) {
+	struct frame key;
+	struct hash_elem *e;
+
+	ASSERT (ofs % PGSIZE == 0);
+	key.cache_inode = inode;
+	key.cache_ofs = ofs;
+	e = hash_find (&cache, &key.cache_elem);
+	return e != NULL ? hash_entry (e, struct frame, cache_elem) : NULL;
+}
+
+/* Indexes FRAME as holding the page of INODE at OFS, which is
+ * page-aligned.  Returns false, leaving FRAME out of the index, if
+ * another frame holds that page already. */
 bool
-page_cache_initializer (struct page *page, enum vm_type type, void *kva) {
-	/* Set up the handler */
-	page->operations = &page_cache_op;
+page_cache_insert (struct frame *frame, struct inode *inode, off_t ofs) {
+	ASSERT (frame->cache_inode == NULL);
+	ASSERT (ofs % PGSIZE == 0);
 
+	frame->cache_inode = inode;
+	frame->cache_ofs = ofs;
+	if (hash_insert (&cache, &frame->cache_elem) != NULL) {
+		frame->cache_inode = NULL;
+		return false;
+	}
+	inode_count_cached (inode, 1);
+	if (++cache_stats.pages > cache_stats.peak)
+		cache_stats.peak = cache_stats.pages;
+	return true;
 }
 
-/* Utilze the Swap in mechanism to implement readhead */
-static bool
-page_cache_readahead (struct page *page, void *kva) {
+/* Removes FRAME from the index, if it is there. */
+void
+page_cache_remove (struct frame *frame) {
+	if (frame->cache_inode == NULL)
+		return;
+	hash_delete (&cache, &frame->cache_elem);
+	inode_count_cached (frame->cache_inode, -1);
+	frame->cache_inode = NULL;
+	cache_stats.pages--;
 }
 
-/* Utilze the Swap out mechanism to implement writeback */
-static bool
-page_cache_writeback (struct page *page) {
+/* Copies SIZE bytes of INODE at OFS into BUF, a kernel buffer, from
+ * the frame that caches them.  The bytes must lie within one page.
+ * Returns false if no frame caches them. */
+bool
+page_cache_read (struct inode *inode, off_t ofs, void *buf, size_t size) {
+	return vm_cache_copy (inode, ofs, buf, size, false);
+}
+
+/* Copies SIZE bytes from BUF, a kernel buffer, into the frame that
+ * caches the bytes of INODE at OFS, if there is one.  The bytes must
+ * lie within one page. */
+void
+page_cache_write (struct inode *inode, off_t ofs, const void *buf,
+		size_t size) {
+	vm_cache_copy (inode, ofs, (void *) buf, size, true);
 }
 
-/* Destory the page_cache. */
-static void
-page_cache_destroy (struct page *page) {
+/* Counts a write to a frame of the page cache if WRITE, otherwise a
+ * read from one. */
+void
+page_cache_hit (bool write) {
+	if (write)
+		cache_stats.write_hits++;
+	else
+		cache_stats.read_hits++;
 }
 
-/* Worker thread for page cache */
-static void
-page_cache_kworkerd (void *aux) {
+/* Prints page cache statistics. */
+void
+page_cache_print_stats (void) {
+	if (cache_stats.peak > 0)
+			printf ("Cache: %zu pages cached, %zu peak; %llu reads and %llu "
+				"writes served from cached pages\n", cache_stats.pages,
+				cache_stats.peak, cache_stats.read_hits, cache_stats.write_hits);
 }
+#endif /* VM */
@@ -1,7 +1,9 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
+#include "devices/disk.h"
 
 struct inode;
 
@@ -9,15 +11,26 @@ struct inode;
 struct file *file_open (struct inode *);
 struct file *file_reopen (struct file *);
 struct file *file_duplicate (struct file *file);
+struct file *file_share (struct file *);
+bool file_is_shared (struct file *);
 void file_close (struct file *);
 struct inode *file_get_inode (struct file *);
 
 /* Reading and writing. */
 off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
+off_t file_read_pages (struct file *, void *const pages[], off_t size,
+		off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
 
+/* Copying without a caller's buffer. */
+off_t file_copy (struct file *dst, struct file *src, off_t size);
+off_t file_copy_from_disk (struct file *, struct disk *, disk_sector_t,
+		off_t size);
+off_t file_copy_to_disk (struct disk *, disk_sector_t, struct file *,
+		off_t size);
+
 /* Preventing writes. */
 void file_deny_write (struct file *);
 void file_allow_write (struct file *);
@@ -14,10 +14,23 @@ struct inode *inode_reopen (struct inode *);
 disk_sector_t inode_get_inumber (const struct inode *);
 void inode_close (struct inode *);
 void inode_remove (struct inode *);
+unsigned inode_get_generation (const struct inode *);
+void inode_count_cached (struct inode *, int cnt);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
+off_t inode_read_pages (struct inode *, void *const pages[], off_t size,
+		off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_write_back_at (struct inode *, const void *, off_t size,
+		off_t offset);
+off_t inode_copy (struct inode *dst, off_t dst_ofs, struct inode *src,
+		off_t src_ofs, off_t size);
+off_t inode_copy_from_disk (struct inode *, off_t offset, struct disk *,
+		disk_sector_t, off_t size);
+off_t inode_copy_to_disk (struct disk *, disk_sector_t, struct inode *,
+		off_t offset, off_t size);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
+bool inode_denies_write (const struct inode *);
 off_t inode_length (const struct inode *);
 
 #endif /* filesys/inode.h */
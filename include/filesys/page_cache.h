@@ -1,12 +1,23 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
-#include "vm/vm.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
 
 struct page;
+struct frame;
+struct inode;
 enum vm_type;
 
 struct page_cache {};
 
-void page_cache_init (void);
-bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+void pagecache_init (void);
+struct frame *page_cache_lookup (struct inode *, off_t ofs);
+bool page_cache_insert (struct frame *, struct inode *, off_t ofs);
+void page_cache_remove (struct frame *);
+bool page_cache_read (struct inode *, off_t ofs, void *buf, size_t size);
+void page_cache_write (struct inode *, off_t ofs, const void *buf,
+		size_t size);
+void page_cache_hit (bool write);
+void page_cache_print_stats (void);
 #endif
@@ -43,6 +43,22 @@ static __inline uint64_t read_eflags(void) {
 	return rflags;
 }
 
+/* Write-protect bit in CR0: when set, the kernel faults on writes
+   to read-only pages just like user code does. */
+#define CR0_WP 0x00010000
+
+__attribute__((always_inline))
+static __inline uint64_t rcr0(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr0,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr0(uint64_t val) {
+	__asm __volatile("movq %0, %%cr0" : : "r" (val));
+}
+
 __attribute__((always_inline))
 static __inline uint64_t rcr3(void) {
 	uint64_t val;
@@ -50,6 +66,50 @@ static __inline uint64_t rcr3(void) {
 	return val;
 }
 
+/* With CR4.PCIDE set, the low 12 bits of CR3 hold the current
+   process-context identifier, and setting bit 63 in a value
+   loaded into CR3 keeps the TLB entries of that PCID.  With
+   CR4.PGE set, TLB entries of pages marked PTE_G survive every
+   CR3 load. */
+#define CR4_PGE 0x00000080
+#define CR4_PCIDE 0x00020000
+#define CR3_NOFLUSH 0x8000000000000000ULL
+
+__attribute__((always_inline))
+static __inline uint64_t rcr4(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr4,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr4(uint64_t val) {
+	__asm __volatile("movq %0, %%cr4" : : "r" (val));
+}
+
+/* CPUID leaf 1, ECX: PCIDs supported; EDX: global pages
+   supported. */
+#define CPUID_1_ECX_PCID 0x00020000
+#define CPUID_1_EDX_PGE 0x00002000
+
+/* Executes CPUID for LEAF and returns ECX. */
+__attribute__((always_inline))
+static __inline uint32_t cpuid_ecx(uint32_t leaf) {
+	uint32_t eax = leaf, ebx, ecx = 0, edx;
+	__asm __volatile("cpuid"
+			: "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+	return ecx;
+}
+
+/* Executes CPUID for LEAF and returns EDX. */
+__attribute__((always_inline))
+static __inline uint32_t cpuid_edx(uint32_t leaf) {
+	uint32_t eax = leaf, ebx, ecx = 0, edx;
+	__asm __volatile("cpuid"
+			: "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+	return edx;
+}
+
 __attribute__((always_inline))
 static __inline uint64_t rrax(void) {
 	uint64_t val;
@@ -1,6 +1,8 @@
 #ifndef __LIB_SYSCALL_NR_H
 #define __LIB_SYSCALL_NR_H
 
+#include <stddef.h>
+
 /* System call numbers. */
 enum {
 	/* Projects 2 and later. */
@@ -36,6 +38,52 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extensions. */
+	SYS_MADVISE,                /* Give an access hint for a mapping. */
+	SYS_MSYNC,                  /* Write a mapping's dirty pages back. */
+	SYS_SPAWN,                  /* Start a process running a program. */
+	SYS_READV,                  /* Read from a file into several buffers. */
+	SYS_WRITEV,                 /* Write several buffers to a file. */
+	SYS_PREAD,                  /* Read from a file at an offset. */
+	SYS_PWRITE,                 /* Write to a file at an offset. */
+	SYS_PREADV,                 /* readv() at an offset. */
+	SYS_PWRITEV,                /* writev() at an offset. */
+	SYS_SENDFILE,               /* Copy between files in the kernel. */
+};
+
+/* Access hints for SYS_MADVISE. */
+enum {
+	MADV_NORMAL,                /* No special treatment. */
+	MADV_RANDOM,                /* Read only the page that faults. */
+	MADV_SEQUENTIAL,            /* Read far ahead, drop pages behind. */
+	MADV_WILLNEED,              /* Read the range in now. */
+	MADV_DONTNEED,              /* Write back and release the range now. */
+};
+
+/* File descriptor actions for SYS_SPAWN, applied in order to the
+ * descriptors the new process inherits. */
+enum {
+	SPAWN_CLOSE,                /* Close FD. */
+	SPAWN_DUP2,                 /* Make NEWFD refer to what FD does. */
+};
+
+struct spawn_action {
+	int type;                   /* SPAWN_CLOSE or SPAWN_DUP2. */
+	int fd;
+	int newfd;                  /* SPAWN_DUP2 only. */
 };
 
+/* Most actions one SYS_SPAWN takes. */
+#define SPAWN_ACTIONS_MAX 32
+
+/* A buffer for SYS_READV, SYS_WRITEV, SYS_PREADV and SYS_PWRITEV. */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Its length in bytes. */
+};
+
+/* Most buffers one vectored transfer takes. */
+#define IOV_MAX 16
+
 #endif /* lib/syscall-nr.h */
@@ -10,4 +10,7 @@ void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
 
+void malloc_thread_exit (void);
+void malloc_stats (void);
+
 #endif /* threads/malloc.h */
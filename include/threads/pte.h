@@ -41,5 +41,17 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=2 MB page (PDEs only). */
+#define PTE_G 0x100                      /* 1=global: kept across CR3 loads. */
+
+/* A page directory entry with PTE_PS set maps a 2 MB superpage
+ * directly, without a page table.  In a PTE the same bit selects a
+ * memory type (PAT), which is never used here. */
+#define LARGE_PGSIZE (1UL << PDXSHIFT)   /* Bytes in a superpage. */
+#define LARGE_PGCNT (LARGE_PGSIZE / PGSIZE)  /* Pages in a superpage. */
+
+/* Software bits, in PTE_AVL, used by fork without VM. */
+#define PTE_SHARED 0x200                 /* Page shared with another process. */
+#define PTE_COW 0x400                    /* Writable once copied on write. */
 
 #endif /* threads/pte.h */
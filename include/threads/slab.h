@@ -0,0 +1,21 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object cache for fixed-size kernel objects. */
+struct slab_cache;
+
+/* Constructor run once on each object when its slab is created.
+   Objects returned to the cache must be left in constructed
+   state, so the constructor is not run again on reuse. */
+typedef void slab_ctor_func (void *obj);
+
+void slab_init (void);
+struct slab_cache *slab_cache_create (const char *name, size_t obj_size,
+                                      slab_ctor_func *ctor);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
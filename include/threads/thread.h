@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"		//system call 추가
+#include "userprog/fdtable.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -128,6 +129,9 @@ struct thread {
 	struct supplemental_page_table spt;
 #endif
 
+	/* Owned by threads/malloc.c. */
+	struct malloc_tcache *tcache;       /* Per-thread free-block cache. */
+
 	/* Owned by thread.c. */
 	struct intr_frame tf;               /* Information for switching */
 	unsigned magic;                     /* Detects stack overflow. */
@@ -146,8 +150,7 @@ struct thread {
 
 
 	//system call file descriptor
-	struct file **fd_table;
-	int fd_idx;
+	struct fd_table fds;
 	
 	struct file *running;
 
@@ -190,6 +193,10 @@ const char *thread_name (void);
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
 
+/* Performs some operation on thread t, given auxiliary data AUX. */
+typedef void thread_action_func (struct thread *t, void *aux);
+void thread_foreach (thread_action_func *, void *);
+
 int thread_get_priority (void);
 void thread_set_priority (int);
 
@@ -211,7 +218,7 @@ void remove_lock(struct lock*);
 
 void rebuild_priority(void);
 
-void thread_preemption();
+void thread_preemption(void);
 
 //mlfqs 관련 methods
 void mlfqs_priority(struct thread *t);
@@ -221,8 +228,4 @@ void mlfqs_increment(void);
 void mlfqs_recalc(void);
 
 
-//system call 
-#define FDT_PAGES 3
-#define FDCOUNT_LIMIT FDT_PAGES * (1<<9)
-
 #endif /* threads/thread.h */
@@ -0,0 +1,23 @@
+#ifndef THREADS_VMALLOC_H
+#define THREADS_VMALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/palloc.h"
+
+/* Kernel virtual range reserved for vmalloc(): 64 MB, far above
+   the direct map of physical memory at KERN_BASE. */
+#define VMALLOC_START 0xc000000000
+#define VMALLOC_PAGES 16384
+#define VMALLOC_END (VMALLOC_START + (uint64_t) VMALLOC_PAGES * PGSIZE)
+
+/* Returns true if VADDR lies in the vmalloc() range. */
+#define is_vmalloc_vaddr(vaddr) \
+	((uint64_t) (vaddr) >= VMALLOC_START && (uint64_t) (vaddr) < VMALLOC_END)
+
+void vmalloc_init (void);
+void *vmalloc (enum palloc_flags, size_t page_cnt);
+void vfree (void *, size_t page_cnt);
+
+#endif /* threads/vmalloc.h */
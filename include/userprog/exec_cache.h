@@ -0,0 +1,49 @@
+#ifndef USERPROG_EXEC_CACHE_H
+#define USERPROG_EXEC_CACHE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/disk.h"
+#include "filesys/off_t.h"
+
+struct inode;
+
+/* A loadable segment of an executable, validated and laid out in
+ * pages as load_segment() takes it. */
+struct exec_segment {
+	off_t ofs;                  /* Page-aligned offset in the file. */
+	void *upage;                /* First user page. */
+	uint32_t read_bytes;        /* Bytes to read from the file. */
+	uint32_t zero_bytes;        /* Bytes to zero after them. */
+	bool writable;              /* Writable by the process? */
+};
+
+/* What load() learns from an executable's headers.  Once cached an
+ * image does not change; exec_cache_release() drops a reference. */
+struct exec_image {
+	uint64_t entry;             /* Entry point. */
+	size_t seg_cnt;             /* Number of segments. */
+	struct exec_segment *segs;  /* Segments, in program header order. */
+
+	/* Owned by exec_cache.c. */
+	struct list_elem elem;      /* Element in the cache. */
+	struct inode *inode;        /* The executable, held open. */
+	disk_sector_t sector;       /* Its inode sector. */
+	unsigned generation;        /* inode_get_generation() when parsed. */
+	int ref_cnt;                /* References, the cache's included. */
+};
+
+/* Whether exec uses the cache. */
+extern bool exec_cache_enabled;
+
+void exec_cache_init (void);
+struct exec_image *exec_image_create (size_t seg_max);
+struct exec_image *exec_cache_lookup (struct inode *inode);
+void exec_cache_insert (struct inode *inode, struct exec_image *image);
+void exec_cache_invalidate (struct inode *inode);
+void exec_cache_release (struct exec_image *image);
+void exec_cache_print_stats (void);
+
+#endif /* userprog/exec_cache.h */
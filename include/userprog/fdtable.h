@@ -0,0 +1,49 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct file;
+
+/* Most file descriptors a process may have open. */
+#define FD_MAX 1536
+
+/* Entries that stand for the console instead of an open file. */
+#define FD_STDIN ((struct file *) 1)
+#define FD_STDOUT ((struct file *) 2)
+
+/* A process's file descriptors.
+ *
+ * All zeros is a valid, empty table that owns no memory, which is
+ * what kernel threads keep.  The arrays are allocated when the first
+ * descriptor is installed and doubled as needed up to FD_MAX
+ * entries.  A bitmap of the descriptors in use, scanned a word at a
+ * time from the lowest word that may have a free bit, finds the
+ * lowest free descriptor. */
+struct fd_table {
+	struct file **files;        /* Entry for each descriptor, or null. */
+	unsigned long *used;        /* Set bits are descriptors in use. */
+	size_t cap;                 /* Descriptors FILES has room for. */
+	size_t free_hint;           /* Words of USED below this are full. */
+	size_t high;                /* One past the highest fd in use. */
+};
+
+/* Returns true if F, a descriptor's entry, stands for the console. */
+static inline bool
+fd_is_console (const struct file *f) {
+	return f == FD_STDIN || f == FD_STDOUT;
+}
+
+bool fdt_init_console (struct fd_table *);
+int fdt_alloc (struct fd_table *, struct file *);
+bool fdt_install (struct fd_table *, int fd, struct file *);
+struct file *fdt_get (const struct fd_table *, int fd);
+struct file *fdt_remove (struct fd_table *, int fd);
+int fdt_next (const struct fd_table *, int fd);
+bool fdt_copy (struct fd_table *dst, const struct fd_table *src);
+bool fdt_full (struct fd_table *);
+void fdt_destroy (struct fd_table *);
+void fdt_print_stats (void);
+
+#endif /* userprog/fdtable.h */
@@ -3,12 +3,20 @@
 
 #include "threads/thread.h"
 
+struct spawn_action;
+
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
+tid_t process_spawn (const char *cmdline,
+		const struct spawn_action *actions, size_t action_cnt);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+#ifndef VM
+bool process_handle_cow (void *addr);
+#endif
+void process_print_stats (void);
 
 
 #endif /* userprog/process.h */
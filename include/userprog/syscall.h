@@ -5,6 +5,7 @@
 #include "threads/synch.h"
 
 void syscall_init (void);
+void exit (int status);
 struct lock filesys_lock;
 
 #endif /* userprog/syscall.h */
@@ -7,11 +7,12 @@ enum vm_type;
 
 struct anon_page {
     //vm
-    disk_sector_t sec_no;
+    size_t slot;                /* Swap slot, or SWAP_SLOT_NONE. */
     struct thread *thread;
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+size_t anon_swap_out_cluster (struct page *pages[], size_t cnt);
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef VM_EVICT_H
+#define VM_EVICT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct frame;
+
+/* A page replacement policy.
+ *
+ * vm.c tells the policy about every frame that becomes evictable
+ * (on_map) and every frame that stops being evictable (on_unmap),
+ * either because it was chosen as a victim or because its page was
+ * freed or pinned.  A kernel thread samples and clears the accessed
+ * bit of every evictable frame periodically and reports it through
+ * on_access.  pick_victim chooses the frame to evict next; it does
+ * not remove it, vm.c calls on_unmap for that.  forget, which a
+ * policy may leave null, drops whatever the policy remembers about
+ * pages of an address space that is being torn down, since its page
+ * table may be reused by another process.
+ *
+ * All hooks are called with the frame table lock held. */
+struct evict_policy {
+	const char *name;                           /* For -vmpolicy=NAME. */
+	void (*init) (void);
+	void (*on_map) (struct frame *);
+	void (*on_access) (struct frame *, bool accessed);
+	struct frame *(*pick_victim) (void);
+	void (*on_unmap) (struct frame *, bool evicted);
+	void (*forget) (const uint64_t *pml4);
+	void (*print_stats) (void);
+};
+
+extern const struct evict_policy evict_clock;
+extern const struct evict_policy evict_2q;
+extern const struct evict_policy evict_clockpro;
+
+bool vm_frame_referenced (struct frame *);
+
+#endif /* vm/evict.h */
@@ -4,36 +4,38 @@
 #include "vm/vm.h"
 
 struct page;
+struct vma;
 enum vm_type;
 
 //vm mmap 관련 추가 구조체
 struct file_page {
 	struct page *page;
 
-	struct file *file;
-	void *start;
-	size_t length;
+	struct file *file;         /* The file of the page's vma. */
 	off_t ofs;
 
 	size_t page_read_bytes;
 	size_t page_zero_bytes;
-
-	struct list_elem file_elem;
 };
 
 struct mmap_aux{
-	struct file *file;
-	void *start;
-	size_t length;
-	off_t ofs;
-	size_t page_read_bytes;
-	size_t page_zero_bytes;
+	struct lazy_load load;     /* Must be first. */
 };
 
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+struct page *file_backed_materialize (struct vma *vma, void *va);
+void file_backed_free_aux (struct mmap_aux *aux);
+bool file_backed_alloc_text (void *upage, struct file *file, off_t ofs);
+bool file_backed_copy_text (struct page *src);
+void file_backed_adopt (struct page *page);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+int do_madvise (void *addr, size_t length, int advice);
+int do_msync (void *addr, size_t length);
+void file_backed_drop (struct page *page);
+void file_backed_write_page (struct page *page, const void *kva);
+void file_backed_print_stats (void);
 #endif
@@ -0,0 +1,29 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct disk;
+
+/* Swap slots hold one page each and are numbered from 0. */
+#define SWAP_SLOT_NONE SIZE_MAX
+
+/* Most pages written to swap in one transfer. */
+#define SWAP_CLUSTER 8
+
+/* Most pages read from swap in one transfer, counting the one
+ * that faulted. */
+#define SWAP_READAHEAD 4
+
+void swap_init (struct disk *);
+size_t swap_alloc (size_t cnt);
+void swap_dup (size_t slot);
+void swap_free (size_t slot, size_t cnt);
+void swap_read (size_t slot, void *const kvas[], size_t cnt);
+void swap_write (size_t slot, const void *const kvas[], size_t cnt);
+void swap_read_disk (size_t slot, void *const kvas[], size_t cnt);
+void swap_write_disk (size_t slot, const void *const kvas[], size_t cnt);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */
@@ -2,13 +2,12 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "filesys/off_t.h"
 
 //vm 추가 사항
 #include <hash.h>
-
-struct list lru;
-struct lock lru_lock;
-struct lock kill_lock;
+#include <list.h>
 
 
 enum vm_type {
@@ -28,10 +27,28 @@ enum vm_type {
 	VM_MARKER_0 = (1 << 3),
 	VM_MARKER_1 = (1 << 4),
 
+	/* The page loads from a file: its uninit aux starts with a
+	 * struct lazy_load. */
+	VM_LAZY_FILE = VM_MARKER_0,
+
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
 };
 
+/* Where a page loaded from a file on first touch gets its contents:
+ * PAGE_READ_BYTES from FILE at OFS, then PAGE_ZERO_BYTES of zeros.
+ * Executable segments and file mappings both put one at the start
+ * of their aux, so that the fault handler can read the untouched
+ * pages around a faulting one together. */
+struct lazy_load {
+	struct file *file;
+	off_t ofs;
+	size_t page_read_bytes;
+	size_t page_zero_bytes;
+	unsigned fault_around;     /* Pages to read per fault; 0 means 1. */
+	bool prefetched;           /* Already read by fault-around. */
+};
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
@@ -41,6 +58,8 @@ enum vm_type {
 
 struct page_operations;
 struct thread;
+struct vma;
+struct inode;
 
 #define VM_TYPE(type) ((type) & 7)
 
@@ -58,7 +77,12 @@ struct page {
 	size_t page_read_bytes;
 	struct hash_elem page_elem;
 	bool writable;
-	bool copy_writable;
+	bool zero_mapped;      /* Mapped read-only to the shared zero frame. */
+	uint64_t *pml4;        /* Page table of the owning process. */
+	struct page *next_share;  /* Next page sharing FRAME, or null. */
+	uint8_t advice;        /* MADV_* access hint of a file mapping. */
+	struct vma *vma;       /* Area of a file mapping, or null. */
+	struct list_elem vma_elem;  /* Element in the area's page list. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -72,12 +96,28 @@ struct page {
 	};
 };
 
-/* The representation of "frame" */
+/* The representation of "frame"
+ *
+ * After fork, parent and child share each resident page's frame
+ * copy-on-write: PAGE heads a chain, linked through next_share, of
+ * the SHARE_CNT pages mapped to the frame, all read-only while
+ * there is more than one. */
 struct frame {
 	void *kva;
 	struct page *page;
 	//vm
-	struct list_elem lru_elem;
+	size_t share_cnt;              /* Pages on the PAGE chain. */
+	bool pinned;                   /* Contents in transit; not evictable. */
+	struct list_elem table_elem;   /* Element in the frame table. */
+
+	/* Owned by the eviction policy (vm/evict.c). */
+	struct list_elem policy_elem;
+	unsigned policy_flags;
+
+	/* Owned by the page cache (filesys/page_cache.c). */
+	struct hash_elem cache_elem;
+	struct inode *cache_inode;     /* File cached, or null if none. */
+	off_t cache_ofs;               /* Offset of the page in it. */
 };
 
 /* The function table for page operations.
@@ -101,6 +141,12 @@ struct page_operations {
  * All designs up to you for this. */
 struct supplemental_page_table {
 	struct hash spt;		//vm 수정사항
+
+	/* File mappings, sorted by address (vm/vma.c).  Their pages
+	 * are added to SPT only as they are used. */
+	struct vma **vmas;
+	size_t vma_cnt;
+	size_t vma_cap;
 };
 
 #include "threads/thread.h"
@@ -111,6 +157,9 @@ void supplemental_page_table_kill (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
+struct page *spt_get_page (struct supplemental_page_table *spt, void *va);
+bool spt_range_free (struct supplemental_page_table *spt,
+		void *start, void *end);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
 void vm_init (void);
@@ -124,14 +173,36 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
 enum vm_type page_get_type (struct page *page);
+struct frame *vm_get_free_frame (void);
+bool vm_map_frame (struct page *page, struct frame *frame);
+struct frame *vm_take_frame (struct page *page);
+void vm_free_frame (struct frame *frame);
+void vm_print_stats (void);
+bool vm_select_policy (const char *name);
+extern bool vm_thp;
+extern unsigned vm_fault_around;
+extern unsigned vm_writeback_rate;
+void vm_lazy_init (struct lazy_load *, struct file *, off_t ofs,
+		size_t page_read_bytes);
+bool vm_lazy_read (struct lazy_load *, void *kva);
+unsigned vm_advice_fault_around (int advice);
+void vm_set_advice (struct page *, int advice);
+bool vm_prefetch (struct page *, size_t cnt);
+void vm_drop_page (struct page *);
+void vm_sync_page (struct page *);
+bool vm_cache_copy (struct inode *, off_t ofs, void *buf, size_t size,
+		bool write);
 
 struct load_segment_aux
 {
-	struct file *file;
-	off_t ofs;
-	size_t page_read_bytes;
-	size_t page_zero_bytes;
+	struct lazy_load load;
 };
 
+/* Object caches for the VM's frequently allocated structures. */
+extern struct slab_cache *page_slab;      /* struct page. */
+extern struct slab_cache *frame_slab;     /* struct frame. */
+extern struct slab_cache *load_aux_slab;  /* struct load_segment_aux. */
+extern struct slab_cache *vma_slab;       /* struct vma. */
+
 
 #endif  /* VM_VM_H */
@@ -0,0 +1,46 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct page;
+struct supplemental_page_table;
+
+/* A virtual memory area: a run of pages of a process mapped from a
+ * file by mmap().  The area describes every page in it, so a page
+ * gets a struct page of its own only once it is used; until then it
+ * costs nothing.  An mmap() call makes one area, which madvise() may
+ * split into several with different hints. */
+struct vma {
+	uint8_t *start;             /* First page. */
+	uint8_t *end;               /* One past the last page. */
+	uint8_t *map_start;         /* Address mmap() returned for it. */
+	struct file *file;          /* Own handle on the mapped file. */
+	off_t ofs;                  /* File offset of START. */
+	size_t read_bytes;          /* Bytes from START backed by FILE. */
+	bool writable;
+	uint8_t advice;             /* MADV_* hint for its pages. */
+	unsigned fault_around;      /* Pages to read per fault. */
+	struct list pages;          /* Pages created so far. */
+};
+
+void vma_init (struct supplemental_page_table *);
+struct vma *vma_alloc (void);
+void vma_free (struct vma *);
+struct vma *vma_find (struct supplemental_page_table *, const void *va);
+bool vma_overlaps (struct supplemental_page_table *,
+		const void *start, const void *end);
+bool vma_insert (struct supplemental_page_table *, struct vma *);
+void vma_remove (struct supplemental_page_table *, struct vma *);
+void vma_add_page (struct vma *, struct page *);
+bool vma_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src);
+void vma_destroy (struct supplemental_page_table *);
+void vma_print_stats (void);
+
+#endif /* vm/vma.h */
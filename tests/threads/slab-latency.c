@@ -0,0 +1,77 @@
+/* Measures how long slab_alloc() and slab_free() take next to
+   malloc() and free(), for objects of a few sizes that malloc()
+   rounds up by different amounts.  Each round allocates BATCH
+   objects and then frees them all, as page faults and file opens
+   do in bursts; rounds repeat until BENCH_TICKS timer ticks have
+   passed.  This is a benchmark, not a test. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "devices/timer.h"
+
+/* Objects allocated and then freed in each round. */
+#define BATCH 256
+
+/* Timer ticks to spend on each allocator and size. */
+#define BENCH_TICKS (TIMER_FREQ * 1)
+
+static void *objs[BATCH];
+
+/* Runs rounds of BATCH allocations and frees through SLAB, or
+   through malloc() if SLAB is null, for BENCH_TICKS ticks.
+   Returns the average nanoseconds per allocation and free. */
+static long long
+measure (struct slab_cache *slab, size_t size)
+{
+  unsigned long long ops = 0;
+  int64_t start;
+  int i;
+
+  /* Start on a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+
+  while (timer_elapsed (start) < BENCH_TICKS)
+    {
+      for (i = 0; i < BATCH; i++)
+        {
+          objs[i] = slab != NULL ? slab_alloc (slab) : malloc (size);
+          if (objs[i] == NULL)
+            fail ("out of memory allocating %zu-byte objects", size);
+        }
+      for (i = 0; i < BATCH; i++)
+        if (slab != NULL)
+          slab_free (slab, objs[i]);
+        else
+          free (objs[i]);
+      ops += BATCH;
+    }
+  return timer_elapsed (start) * (1000000000LL / TIMER_FREQ) / ops;
+}
+
+void
+test_slab_latency (void) 
+{
+  static const size_t sizes[] = {24, 72, 136, 264};
+  size_t i;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      struct slab_cache *slab;
+      char name[16];
+      long long slab_ns, malloc_ns;
+
+      snprintf (name, sizeof name, "bench-%zu", sizes[i]);
+      slab = slab_cache_create (name, sizes[i], NULL);
+      if (slab == NULL)
+        fail ("slab_cache_create failed");
+      slab_ns = measure (slab, sizes[i]);
+      malloc_ns = measure (NULL, sizes[i]);
+      msg ("%zu-byte objects: slab %lld ns, malloc %lld ns per allocation",
+           sizes[i], slab_ns, malloc_ns);
+    }
+}
@@ -0,0 +1,19 @@
+/* Child process run by the spawn-close and spawn-dup2 tests.
+   Prints the size of the file open on each file descriptor given
+   on its command line, or -1 if none is. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-fd";
+
+int
+main (int argc, char *argv[]) 
+{
+  int i;
+
+  for (i = 1; i < argc; i++)
+    msg ("argv[%d]: filesize = %d", i, filesize (atoi (argv[i])));
+  return 0;
+}
@@ -0,0 +1,75 @@
+/* Copies a file ROUNDS times in one of two ways given as the
+   argument: "rw" with a loop of reads and writes through a buffer
+   in user memory, "send" with a single sendfile.  Not a test: "make
+   copy-bench" runs it both ways to compare the time and disk
+   traffic they take. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "copy-file";
+
+#define FILE_SIZE (64 * 1024)
+#define BUF_SIZE 4096
+#define ROUNDS 16
+
+static char buf[BUF_SIZE];
+static char check[BUF_SIZE];
+
+/* Copies all of SRC to DST, both at offset 0, through BUF. */
+static void
+copy_rw (int dst, int src)
+{
+  int n;
+
+  while ((n = read (src, buf, sizeof buf)) > 0)
+    if (write (dst, buf, n) != n)
+      fail ("write of %d bytes failed", n);
+}
+
+int
+main (int argc, char *argv[])
+{
+  bool send;
+  int src, dst, round, ofs, i;
+
+  if (argc == 2 && !strcmp (argv[1], "rw"))
+    send = false;
+  else if (argc == 2 && !strcmp (argv[1], "send"))
+    send = true;
+  else
+    fail ("usage: copy-file rw|send");
+
+  CHECK (create ("copy-src", FILE_SIZE), "create \"copy-src\"");
+  CHECK (create ("copy-dst", FILE_SIZE), "create \"copy-dst\"");
+  CHECK ((src = open ("copy-src")) > 1, "open \"copy-src\"");
+  CHECK ((dst = open ("copy-dst")) > 1, "open \"copy-dst\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BUF_SIZE)
+    {
+      for (i = 0; i < BUF_SIZE; i++)
+        buf[i] = (ofs + i) * 7;
+      if (write (src, buf, BUF_SIZE) != BUF_SIZE)
+        fail ("filling \"copy-src\" failed");
+    }
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      seek (src, 0);
+      seek (dst, 0);
+      if (!send)
+        copy_rw (dst, src);
+      else if (sendfile (dst, src, FILE_SIZE) != FILE_SIZE)
+        fail ("sendfile copied short");
+    }
+
+  seek (src, 0);
+  seek (dst, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BUF_SIZE)
+    if (read (src, buf, BUF_SIZE) != BUF_SIZE
+        || read (dst, check, BUF_SIZE) != BUF_SIZE
+        || memcmp (buf, check, BUF_SIZE))
+      fail ("copy differs at offset %d", ofs);
+  msg ("%d copies of %d kB", ROUNDS, FILE_SIZE / 1024);
+  return 0;
+}
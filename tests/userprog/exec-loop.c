@@ -0,0 +1,31 @@
+/* Runs child-simple ROUNDS times, one after another, each in a
+   freshly forked process.  Not a test: run it with and without
+   -noexeccache ("make exec-bench") to compare how long each exec
+   takes to load the program. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 128
+
+void
+test_main (void)
+{
+  int round;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      pid_t pid = fork ("exec-loop");
+      if (pid == 0)
+        {
+          exec ("child-simple");
+          fail ("exec \"child-simple\"");
+        }
+      if (pid < 0)
+        fail ("fork() returned %d", pid);
+      if (wait (pid) != 81)
+        fail ("child-simple did not exit cleanly");
+    }
+  msg ("%d execs", ROUNDS);
+}
@@ -0,0 +1,78 @@
+/* Checks that exec does not use what it cached about an
+   executable once the file has been removed or written.
+   Each run copies child-simple to child-copy the same way, so a
+   new file that reuses the removed one's inode looks the same as
+   it did apart from its contents. */
+
+#include <stdbool.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+
+/* Copies child-simple to child-copy, with its ELF magic number
+   replaced by MAGIC. */
+static void
+copy_child (const char *magic)
+{
+  bool first = true;
+  int src, dst, n;
+
+  if ((src = open ("child-simple")) < 2)
+    fail ("open \"child-simple\" failed");
+  if (!create ("child-copy", filesize (src)))
+    fail ("create \"child-copy\" failed");
+  if ((dst = open ("child-copy")) < 2)
+    fail ("open \"child-copy\" failed");
+  while ((n = read (src, buf, sizeof buf)) > 0)
+    {
+      if (first)
+        memcpy (buf, magic, 4);
+      first = false;
+      if (write (dst, buf, n) != n)
+        fail ("write \"child-copy\" failed");
+    }
+  close (src);
+  close (dst);
+}
+
+/* Writes MAGIC over the ELF magic number of child-copy. */
+static void
+write_magic (const char *magic)
+{
+  int fd;
+
+  if ((fd = open ("child-copy")) < 2)
+    fail ("open \"child-copy\" failed");
+  if (write (fd, magic, 4) != 4)
+    fail ("write \"child-copy\" failed");
+  close (fd);
+}
+
+/* Runs child-copy in a child process and returns its exit
+   status. */
+static int
+run_child (void)
+{
+  pid_t pid = fork ("child");
+
+  if (pid == 0)
+    exit (exec ("child-copy"));
+  return wait (pid);
+}
+
+void
+test_main (void) 
+{
+  copy_child ("\177ELF");
+  CHECK (run_child () == 81, "run child-copy");
+  CHECK (remove ("child-copy"), "remove child-copy");
+  copy_child ("XELF");
+  CHECK (run_child () == -1, "run child-copy with a bad header");
+  write_magic ("\177ELF");
+  CHECK (run_child () == 81, "run child-copy with its header restored");
+  write_magic ("XELF");
+  CHECK (run_child () == -1, "run child-copy after writing its header");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(exec-stale) begin
+(exec-stale) run child-copy
+(child-simple) run
+child: exit(81)
+(exec-stale) remove child-copy
+(exec-stale) run child-copy with a bad header
+load: child-copy: error loading executable
+child: exit(-1)
+(exec-stale) run child-copy with its header restored
+(child-simple) run
+child: exit(81)
+(exec-stale) run child-copy after writing its header
+load: child-copy: error loading executable
+child: exit(-1)
+(exec-stale) end
+exec-stale: exit(0)
+EOF
+pass;
@@ -0,0 +1,35 @@
+/* Opens sample.txt FDS times, closes every other descriptor and
+   opens those again, then closes everything, ROUNDS times, checking
+   that each open gets the lowest free descriptor.  Not a test: "make
+   fd-bench" runs it to show the cost of descriptor allocation and
+   the memory descriptor tables take. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FDS 1000
+#define ROUNDS 8
+
+static int fds[FDS];
+
+void
+test_main (void)
+{
+  int round, i;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      for (i = 0; i < FDS; i++)
+        if ((fds[i] = open ("sample.txt")) != i + 2)
+          fail ("open returned %d, not %d", fds[i], i + 2);
+      for (i = 1; i < FDS; i += 2)
+        close (fds[i]);
+      for (i = 1; i < FDS; i += 2)
+        if (open ("sample.txt") != fds[i])
+          fail ("reopen did not return %d", fds[i]);
+      for (i = 0; i < FDS; i++)
+        close (fds[i]);
+    }
+  msg ("%d rounds of %d descriptors", ROUNDS, FDS);
+}
@@ -0,0 +1,46 @@
+/* Opens more descriptors than fit in the initial descriptor
+   table, closes a few of them, and checks that each new open
+   gets the lowest descriptor that is free. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FD_CNT 200
+
+static int fds[FD_CNT];
+
+void
+test_main (void) 
+{
+  char buf;
+  int i;
+
+  for (i = 0; i < FD_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] < 2)
+        fail ("open \"sample.txt\" number %d failed", i + 1);
+      if (i > 0 && fds[i] != fds[i - 1] + 1)
+        fail ("open returned %d after %d", fds[i], fds[i - 1]);
+    }
+  msg ("open \"sample.txt\" %d times", FD_CNT);
+  CHECK (read (fds[FD_CNT - 1], &buf, 1) == 1,
+         "read from the last descriptor");
+
+  close (fds[130]);
+  close (fds[70]);
+  close (fds[3]);
+  CHECK (open ("sample.txt") == fds[3], "reopen gets descriptor %d", fds[3]);
+  CHECK (open ("sample.txt") == fds[70], "reopen gets descriptor %d",
+         fds[70]);
+  CHECK (open ("sample.txt") == fds[130], "reopen gets descriptor %d",
+         fds[130]);
+  CHECK (open ("sample.txt") == fds[FD_CNT - 1] + 1,
+         "next open gets descriptor %d", fds[FD_CNT - 1] + 1);
+
+  for (i = 0; i < FD_CNT; i++)
+    close (fds[i]);
+  CHECK (open ("sample.txt") == fds[0], "open after closing all gets %d",
+         fds[0]);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fd-lowest) begin
+(fd-lowest) open "sample.txt" 200 times
+(fd-lowest) read from the last descriptor
+(fd-lowest) reopen gets descriptor 5
+(fd-lowest) reopen gets descriptor 72
+(fd-lowest) reopen gets descriptor 132
+(fd-lowest) next open gets descriptor 202
+(fd-lowest) open after closing all gets 2
+(fd-lowest) end
+fd-lowest: exit(0)
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Opens sample.txt N times, then forks ROUNDS children that exit at
+   once, one after another.  Not a test: "make forkfd-bench" runs it
+   for several N to show how fork time grows with the number of open
+   descriptors. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "fork-fds";
+
+#define ROUNDS 64
+
+int
+main (int argc, char *argv[])
+{
+  int fds, round, i;
+
+  if (argc != 2 || (fds = atoi (argv[1])) < 0)
+    fail ("usage: fork-fds N");
+  for (i = 0; i < fds; i++)
+    if (open ("sample.txt") < 0)
+      fail ("open #%d failed", i);
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      pid_t pid = fork ("fork-fds");
+      if (pid == 0)
+        exit (0);
+      if (pid < 0)
+        fail ("fork() returned %d", pid);
+      if (wait (pid) != 0)
+        fail ("child did not exit cleanly");
+    }
+  msg ("%d forks with %d descriptors open", ROUNDS, fds);
+  return 0;
+}
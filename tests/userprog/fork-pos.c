@@ -0,0 +1,45 @@
+/* Checks that a parent and a child keep separate positions in a
+   file that was open when they forked, whichever of them moves
+   its position first. */
+
+#include <stdbool.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[10];
+  pid_t pid;
+  int handle;
+  bool ok;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, sizeof buf) == (int) sizeof buf,
+         "read \"sample.txt\"");
+
+  if ((pid = fork ("child")) == 0)
+    {
+      CHECK (tell (handle) == sizeof buf, "child's position is %zu",
+             sizeof buf);
+      CHECK (read (handle, buf, sizeof buf) == (int) sizeof buf
+             && !memcmp (buf, sample + sizeof buf, sizeof buf),
+             "child reads from there");
+      seek (handle, 100);
+      CHECK (tell (handle) == 100, "child seeks to 100");
+      exit (0);
+    }
+
+  /* Move the position while the child may still be using its own,
+     but report only once the child is done. */
+  ok = (read (handle, buf, sizeof buf) == (int) sizeof buf
+        && !memcmp (buf, sample + sizeof buf, sizeof buf));
+  CHECK (wait (pid) == 0, "wait for child");
+  CHECK (ok, "parent reads from the same position");
+  CHECK (tell (handle) == 2 * sizeof buf,
+         "parent's position is %zu, not the child's", 2 * sizeof buf);
+  close (handle);
+}
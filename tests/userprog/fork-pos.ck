@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-pos) begin
+(fork-pos) open "sample.txt"
+(fork-pos) read "sample.txt"
+(fork-pos) child's position is 10
+(fork-pos) child reads from there
+(fork-pos) child seeks to 100
+child: exit(0)
+(fork-pos) wait for child
+(fork-pos) parent reads from the same position
+(fork-pos) parent's position is 20, not the child's
+(fork-pos) end
+fork-pos: exit(0)
+EOF
+pass;
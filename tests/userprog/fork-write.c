@@ -0,0 +1,55 @@
+/* Forks while data and stack pages are shared, then has the
+   parent and the child each overwrite them.  Neither may see the
+   other's writes, whether fork copied the pages or shares them
+   until they are written. */
+
+#include <stdbool.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char data[3 * 4096] = {1};
+
+/* Returns true if all SIZE bytes at P are C. */
+static bool
+all_equal (const char *p, size_t size, char c)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void) 
+{
+  char stack[512];
+  pid_t pid;
+
+  memset (data, 'p', sizeof data);
+  memset (stack, 's', sizeof stack);
+
+  if ((pid = fork ("child")) == 0)
+    {
+      CHECK (all_equal (data, sizeof data, 'p')
+             && all_equal (stack, sizeof stack, 's'),
+             "child sees the parent's data");
+      memset (data, 'c', sizeof data);
+      memset (stack, 'c', sizeof stack);
+      CHECK (all_equal (data, sizeof data, 'c')
+             && all_equal (stack, sizeof stack, 'c'),
+             "child sees its writes");
+      exit (0);
+    }
+
+  /* Write while the child may still be reading. */
+  memset (data, 'P', sizeof data);
+  memset (stack, 'S', sizeof stack);
+  CHECK (wait (pid) == 0, "wait for child");
+  CHECK (all_equal (data, sizeof data, 'P')
+         && all_equal (stack, sizeof stack, 'S'),
+         "parent sees its writes and not the child's");
+}
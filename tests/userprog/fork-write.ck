@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-write) begin
+(fork-write) child sees the parent's data
+(fork-write) child sees its writes
+child: exit(0)
+(fork-write) wait for child
+(fork-write) parent sees its writes and not the child's
+(fork-write) end
+fork-write: exit(0)
+EOF
+pass;
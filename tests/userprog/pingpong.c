@@ -0,0 +1,35 @@
+/* Bounces control between a process and a series of children
+   that exit at once, ROUNDS times.  Each round is a fork, a switch
+   to the child, its exit and a switch back, after which the parent
+   touches its working set again.  Not a test: run it with and
+   without -nopcid ("make pcid-bench") to compare how much the
+   switches cost. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 256
+#define PAGES 64
+
+static char pages[PAGES][4096];
+
+void
+test_main (void)
+{
+  int round, i;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      pid_t pid = fork ("pong");
+      if (pid == 0)
+        exit (0);
+      if (pid < 0)
+        fail ("fork() returned %d", pid);
+      if (wait (pid) != 0)
+        fail ("child did not exit cleanly");
+      for (i = 0; i < PAGES; i++)
+        pages[i][0]++;
+    }
+  msg ("%d round trips", ROUNDS);
+}
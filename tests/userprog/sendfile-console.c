@@ -0,0 +1,21 @@
+/* Passes the console to sendfile() as either end.  Each call must
+   return -1. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  msg ("sendfile to stdout: %d", sendfile (STDOUT_FILENO, handle, 10));
+  msg ("sendfile from stdin: %d", sendfile (handle, STDIN_FILENO, 10));
+  msg ("sendfile to stdin: %d", sendfile (STDIN_FILENO, handle, 10));
+  msg ("sendfile from stdout: %d", sendfile (handle, STDOUT_FILENO, 10));
+  msg ("sendfile from a closed fd: %d", sendfile (handle, 100, 10));
+}
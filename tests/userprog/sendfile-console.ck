@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile-console) begin
+(sendfile-console) open "sample.txt"
+(sendfile-console) sendfile to stdout: -1
+(sendfile-console) sendfile from stdin: -1
+(sendfile-console) sendfile to stdin: -1
+(sendfile-console) sendfile from stdout: -1
+(sendfile-console) sendfile from a closed fd: -1
+(sendfile-console) end
+sendfile-console: exit(0)
+EOF
+pass;
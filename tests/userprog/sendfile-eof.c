@@ -0,0 +1,30 @@
+/* Asks sendfile() for more bytes than are left in the input file.
+   It must copy only those and then, at the end of the file,
+   nothing. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TAIL 10
+
+void
+test_main (void) 
+{
+  const int size = sizeof sample - 1;
+  char buf[TAIL];
+  int in, out;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("test.txt", 100), "create \"test.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  seek (in, size - TAIL);
+  msg ("sendfile across end: %d", sendfile (out, in, 100));
+  msg ("sendfile at end: %d", sendfile (out, in, 100));
+  msg ("output position: %u", tell (out));
+
+  CHECK (pread (out, buf, TAIL, 0) == TAIL, "read back");
+  compare_bytes (buf, sample + size - TAIL, TAIL, 0, "test.txt");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile-eof) begin
+(sendfile-eof) open "sample.txt"
+(sendfile-eof) create "test.txt"
+(sendfile-eof) open "test.txt"
+(sendfile-eof) sendfile across end: 10
+(sendfile-eof) sendfile at end: 0
+(sendfile-eof) output position: 10
+(sendfile-eof) read back
+(sendfile-eof) end
+sendfile-eof: exit(0)
+EOF
+pass;
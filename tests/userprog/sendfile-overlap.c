@@ -0,0 +1,34 @@
+/* Copies within one file with sendfile().  Copying between ranges
+   that do not overlap must work; copying between ranges that do
+   must return -1 and leave both positions alone. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const int size = sizeof sample - 1;
+  char buf[sizeof sample];
+  int in, out;
+
+  CHECK (create ("test.txt", 2 * size), "create \"test.txt\"");
+  CHECK ((in = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\" again");
+  CHECK (write (out, sample, size) == size, "write sample");
+
+  msg ("sendfile to after itself: %d", sendfile (out, in, size));
+
+  seek (in, 0);
+  seek (out, 10);
+  msg ("sendfile overlapping ahead: %d", sendfile (out, in, 100));
+  seek (in, 10);
+  seek (out, 0);
+  msg ("sendfile overlapping behind: %d", sendfile (out, in, 100));
+  msg ("positions: %u %u", tell (in), tell (out));
+
+  CHECK (pread (in, buf, size, size) == size, "read back the copy");
+  compare_bytes (buf, sample, size, 0, "test.txt");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile-overlap) begin
+(sendfile-overlap) create "test.txt"
+(sendfile-overlap) open "test.txt"
+(sendfile-overlap) open "test.txt" again
+(sendfile-overlap) write sample
+(sendfile-overlap) sendfile to after itself: 373
+(sendfile-overlap) sendfile overlapping ahead: -1
+(sendfile-overlap) sendfile overlapping behind: -1
+(sendfile-overlap) positions: 10 0
+(sendfile-overlap) read back the copy
+(sendfile-overlap) end
+sendfile-overlap: exit(0)
+EOF
+pass;
@@ -0,0 +1,29 @@
+/* Copies part of a file to another with sendfile(), which must copy
+   from the input file's position to the output file's and advance
+   both. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SKIP 5
+#define COPY 50
+
+void
+test_main (void) 
+{
+  int in, out;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("test.txt", COPY), "create \"test.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  seek (in, SKIP);
+  msg ("sendfile: %d", sendfile (out, in, COPY));
+  msg ("input position: %u", tell (in));
+  msg ("output position: %u", tell (out));
+
+  seek (out, 0);
+  check_file_handle (out, "test.txt", sample + SKIP, COPY);
+}
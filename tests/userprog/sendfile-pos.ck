@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile-pos) begin
+(sendfile-pos) open "sample.txt"
+(sendfile-pos) create "test.txt"
+(sendfile-pos) open "test.txt"
+(sendfile-pos) sendfile: 50
+(sendfile-pos) input position: 55
+(sendfile-pos) output position: 50
+(sendfile-pos) verified contents of "test.txt"
+(sendfile-pos) end
+sendfile-pos: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Passes invalid file descriptor actions to spawn(), which must
+   return -1 for each without running the program. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+try_spawn (const char *what, const struct spawn_action *actions,
+           size_t action_cnt) 
+{
+  msg ("%s: %d", what, spawn ("child-simple", actions, action_cnt));
+}
+
+void
+test_main (void) 
+{
+  struct spawn_action many[SPAWN_ACTIONS_MAX + 1];
+  int handle;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  struct spawn_action bad_type[] = {{99, handle, 0}};
+  try_spawn ("unknown action", bad_type, 1);
+
+  struct spawn_action closed_fd[] = {{SPAWN_DUP2, 100, 3}};
+  try_spawn ("dup2 of a closed fd", closed_fd, 1);
+
+  struct spawn_action negative_fd[] = {{SPAWN_DUP2, handle, -1}};
+  try_spawn ("dup2 to a negative fd", negative_fd, 1);
+
+  struct spawn_action huge_fd[] = {{SPAWN_DUP2, handle, 1 << 20}};
+  try_spawn ("dup2 to a huge fd", huge_fd, 1);
+
+  for (i = 0; i < sizeof many / sizeof *many; i++)
+    many[i] = (struct spawn_action) {SPAWN_CLOSE, handle, 0};
+  try_spawn ("too many actions", many, sizeof many / sizeof *many);
+}
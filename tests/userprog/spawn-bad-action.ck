@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(spawn-bad-action) begin
+(spawn-bad-action) open "sample.txt"
+(spawn-bad-action) unknown action: -1
+(spawn-bad-action) dup2 of a closed fd: -1
+(spawn-bad-action) dup2 to a negative fd: -1
+(spawn-bad-action) dup2 to a huge fd: -1
+(spawn-bad-action) too many actions: -1
+(spawn-bad-action) end
+EOF
+pass;
@@ -0,0 +1,11 @@
+/* Passes an invalid pointer to the spawn system call.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  spawn ((char *) 0x20101234, NULL, 0);
+}
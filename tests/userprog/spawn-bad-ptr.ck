@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(spawn-bad-ptr) begin
+(spawn-bad-ptr) end
+spawn-bad-ptr: exit(0)
+EOF
+(spawn-bad-ptr) begin
+spawn-bad-ptr: exit(-1)
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Spawns a subprocess with a SPAWN_CLOSE action for an open file.
+   The subprocess must not have the file, and the parent must
+   still have it. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char child_cmd[128];
+  int handle;
+  pid_t pid;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  struct spawn_action actions[] = {{SPAWN_CLOSE, handle, 0}};
+  snprintf (child_cmd, sizeof child_cmd, "child-fd %d", handle);
+  pid = spawn (child_cmd, actions, 1);
+  msg ("wait(spawn()) = %d", wait (pid));
+
+  check_file_handle (handle, "sample.txt", sample, sizeof sample - 1);
+}
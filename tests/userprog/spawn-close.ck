@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-close) begin
+(spawn-close) open "sample.txt"
+(child-fd) argv[1]: filesize = -1
+child-fd: exit(0)
+(spawn-close) wait(spawn()) = 0
+(spawn-close) verified contents of "sample.txt"
+(spawn-close) end
+spawn-close: exit(0)
+EOF
+pass;
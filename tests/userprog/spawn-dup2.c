@@ -0,0 +1,34 @@
+/* Spawns a subprocess with a SPAWN_DUP2 action that moves an open
+   file to another file descriptor, then a SPAWN_CLOSE action for
+   the old one.  The subprocess must have the file on the new file
+   descriptor only, and the parent must still have it on the old
+   one. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define NEWFD 20
+
+void
+test_main (void) 
+{
+  char child_cmd[128];
+  int handle;
+  pid_t pid;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  struct spawn_action actions[] = {
+    {SPAWN_DUP2, handle, NEWFD},
+    {SPAWN_CLOSE, handle, 0},
+  };
+  snprintf (child_cmd, sizeof child_cmd, "child-fd %d %d", handle, NEWFD);
+  pid = spawn (child_cmd, actions, 2);
+  msg ("wait(spawn()) = %d", wait (pid));
+
+  check_file_handle (handle, "sample.txt", sample, sizeof sample - 1);
+  msg ("filesize(%d) = %d", NEWFD, filesize (NEWFD));
+}
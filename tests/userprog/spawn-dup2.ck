@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-dup2) begin
+(spawn-dup2) open "sample.txt"
+(child-fd) argv[1]: filesize = -1
+(child-fd) argv[2]: filesize = 373
+child-fd: exit(0)
+(spawn-dup2) wait(spawn()) = 0
+(spawn-dup2) verified contents of "sample.txt"
+(spawn-dup2) filesize(20) = -1
+(spawn-dup2) end
+spawn-dup2: exit(0)
+EOF
+pass;
@@ -0,0 +1,28 @@
+/* Runs child-simple ROUNDS times, one after another, each in a
+   process started by spawn(), which does not copy this one.  Not a
+   test: "make spawn-bench" compares it with exec-loop, which forks
+   and execs instead. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 128
+
+void
+test_main (void)
+{
+  /* The child needs nothing but the console. */
+  struct spawn_action actions[] = {{SPAWN_CLOSE, 0, 0}};
+  int round;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      pid_t pid = spawn ("child-simple", actions, 1);
+      if (pid < 0)
+        fail ("spawn() returned %d", pid);
+      if (wait (pid) != 81)
+        fail ("child-simple did not exit cleanly");
+    }
+  msg ("%d spawns", ROUNDS);
+}
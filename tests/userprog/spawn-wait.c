@@ -0,0 +1,14 @@
+/* Spawns a subprocess and waits for it twice.  The first wait must
+   return its exit code and the second -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t pid = spawn ("child-simple", NULL, 0);
+  msg ("wait(spawn()) = %d", wait (pid));
+  msg ("wait(spawn()) = %d", wait (pid));
+}
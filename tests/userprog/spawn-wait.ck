@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-wait) begin
+(child-simple) run
+child-simple: exit(81)
+(spawn-wait) wait(spawn()) = 81
+(spawn-wait) wait(spawn()) = -1
+(spawn-wait) end
+spawn-wait: exit(0)
+EOF
+pass;
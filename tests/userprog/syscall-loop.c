@@ -0,0 +1,38 @@
+/* Makes CALLS empty write() system calls in each of two processes,
+   so that the scheduler switches address spaces between them while
+   they run.  Not a test: run it with and without -nopge ("make
+   pge-bench") to compare how much a system call costs when the
+   kernel's TLB entries do not survive the switches. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALLS 100000
+
+static void
+loop (void)
+{
+  static const char byte = 0;
+  int i;
+
+  for (i = 0; i < CALLS; i++)
+    if (write (STDOUT_FILENO, &byte, 0) != 0)
+      fail ("write() did not return 0");
+}
+
+void
+test_main (void)
+{
+  pid_t pid = fork ("syscall-loop");
+
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+  loop ();
+  if (pid == 0)
+    exit (0);
+  if (wait (pid) != 0)
+    fail ("child did not exit cleanly");
+  msg ("%d system calls", 2 * CALLS);
+}
@@ -0,0 +1,44 @@
+/* Passes invalid arguments to the vectored and positional read and
+   write system calls: negative offsets, too many or a negative
+   number of buffers, and the console where a file is needed.  Each
+   call must return -1. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  struct iovec iov[IOV_MAX + 1];
+  int handle;
+  int i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (i = 0; i < IOV_MAX + 1; i++)
+    {
+      iov[i].iov_base = buf;
+      iov[i].iov_len = 1;
+    }
+
+  msg ("pread at -1: %d", pread (handle, buf, sizeof buf, -1));
+  msg ("pwrite at -1: %d", pwrite (handle, buf, sizeof buf, -1));
+  msg ("preadv at -1: %d", preadv (handle, iov, 1, -1));
+  msg ("pwritev at -1: %d", pwritev (handle, iov, 1, -1));
+
+  msg ("readv of IOV_MAX + 1: %d", readv (handle, iov, IOV_MAX + 1));
+  msg ("writev of IOV_MAX + 1: %d", writev (handle, iov, IOV_MAX + 1));
+  msg ("preadv of IOV_MAX + 1: %d", preadv (handle, iov, IOV_MAX + 1, 0));
+  msg ("readv of -1: %d", readv (handle, iov, -1));
+  msg ("writev of -1: %d", writev (handle, iov, -1));
+  msg ("pwritev of -1: %d", pwritev (handle, iov, -1, 0));
+
+  msg ("pread from stdin: %d", pread (STDIN_FILENO, buf, sizeof buf, 0));
+  msg ("pwrite to stdout: %d", pwrite (STDOUT_FILENO, buf, sizeof buf, 0));
+  msg ("preadv from stdin: %d", preadv (STDIN_FILENO, iov, 1, 0));
+  msg ("pwritev to stdout: %d", pwritev (STDOUT_FILENO, iov, 1, 0));
+  msg ("readv from stdout: %d", readv (STDOUT_FILENO, iov, 1));
+  msg ("writev to stdin: %d", writev (STDIN_FILENO, iov, 1));
+}
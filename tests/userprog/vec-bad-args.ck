@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vec-bad-args) begin
+(vec-bad-args) open "sample.txt"
+(vec-bad-args) pread at -1: -1
+(vec-bad-args) pwrite at -1: -1
+(vec-bad-args) preadv at -1: -1
+(vec-bad-args) pwritev at -1: -1
+(vec-bad-args) readv of IOV_MAX + 1: -1
+(vec-bad-args) writev of IOV_MAX + 1: -1
+(vec-bad-args) preadv of IOV_MAX + 1: -1
+(vec-bad-args) readv of -1: -1
+(vec-bad-args) writev of -1: -1
+(vec-bad-args) pwritev of -1: -1
+(vec-bad-args) pread from stdin: -1
+(vec-bad-args) pwrite to stdout: -1
+(vec-bad-args) preadv from stdin: -1
+(vec-bad-args) pwritev to stdout: -1
+(vec-bad-args) readv from stdout: -1
+(vec-bad-args) writev to stdin: -1
+(vec-bad-args) end
+vec-bad-args: exit(0)
+EOF
+pass;
@@ -0,0 +1,19 @@
+/* Passes readv() a buffer at an unmapped address.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  struct iovec iov[] = {{buf, sizeof buf}, {(void *) 0x20101234, 123}};
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  readv (handle, iov, 2);
+  fail ("should not have survived readv()");
+}
@@ -0,0 +1,36 @@
+/* Reads across and past the end of a file with pread(), preadv()
+   and readv(), which must stop short at the end of the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TAIL 10
+
+void
+test_main (void) 
+{
+  const int size = sizeof sample - 1;
+  char buf[128];
+  struct iovec iov[] = {{buf, 5}, {buf + 5, 100}};
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  memset (buf, 0, sizeof buf);
+  msg ("pread across end: %d", pread (handle, buf, 100, size - TAIL));
+  compare_bytes (buf, sample + size - TAIL, TAIL, size - TAIL, "sample.txt");
+
+  memset (buf, 0, sizeof buf);
+  msg ("preadv across end: %d", preadv (handle, iov, 2, size - TAIL));
+  compare_bytes (buf, sample + size - TAIL, TAIL, size - TAIL, "sample.txt");
+
+  msg ("pread at end: %d", pread (handle, buf, 100, size));
+  msg ("pread past end: %d", pread (handle, buf, 100, size + 1000));
+
+  seek (handle, size - TAIL);
+  msg ("readv across end: %d", readv (handle, iov, 2));
+  msg ("readv at end: %d", readv (handle, iov, 2));
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vec-eof) begin
+(vec-eof) open "sample.txt"
+(vec-eof) pread across end: 10
+(vec-eof) preadv across end: 10
+(vec-eof) pread at end: 0
+(vec-eof) pread past end: 0
+(vec-eof) readv across end: 10
+(vec-eof) readv at end: 0
+(vec-eof) end
+vec-eof: exit(0)
+EOF
+pass;
@@ -0,0 +1,98 @@
+/* Writes and then reads back every record of a file ROUNDS times,
+   each record a group of FIELDS fields at scattered places in
+   memory, in one of three ways given as the argument: "seek" does a
+   seek and a write or read per field, "pos" a pwrite or pread per
+   field, and "vec" one pwritev or preadv per record.  Not a test:
+   "make vecio-bench" runs it each way to compare the time they
+   take. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "vec-io";
+
+#define FIELDS 8
+#define FIELD_SIZE 64
+#define RECORD_SIZE (FIELDS * FIELD_SIZE)
+#define RECORDS 64
+#define ROUNDS 16
+
+/* A record's fields as written, and as read back. */
+static char fields[FIELDS][FIELD_SIZE];
+static char check[FIELDS][FIELD_SIZE];
+
+enum mode { SEEK, POS, VEC };
+
+/* Moves record R between the file open as FD and BUF, writing if
+   WRITING, in MODE's way. */
+static void
+transfer (int fd, char buf[FIELDS][FIELD_SIZE], int r, bool writing,
+          enum mode mode)
+{
+  int ofs = r * RECORD_SIZE;
+  int i, n;
+
+  if (mode == VEC)
+    {
+      struct iovec iov[FIELDS];
+
+      for (i = 0; i < FIELDS; i++)
+        {
+          iov[i].iov_base = buf[i];
+          iov[i].iov_len = FIELD_SIZE;
+        }
+      n = writing ? pwritev (fd, iov, FIELDS, ofs)
+                  : preadv (fd, iov, FIELDS, ofs);
+      if (n != RECORD_SIZE)
+        fail ("record %d: transferred %d bytes", r, n);
+      return;
+    }
+
+  for (i = 0; i < FIELDS; i++, ofs += FIELD_SIZE)
+    {
+      if (mode == SEEK)
+        {
+          seek (fd, ofs);
+          n = writing ? write (fd, buf[i], FIELD_SIZE)
+                      : read (fd, buf[i], FIELD_SIZE);
+        }
+      else
+        n = writing ? pwrite (fd, buf[i], FIELD_SIZE, ofs)
+                    : pread (fd, buf[i], FIELD_SIZE, ofs);
+      if (n != FIELD_SIZE)
+        fail ("record %d field %d: transferred %d bytes", r, i, n);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  enum mode mode;
+  int fd, round, r;
+
+  if (argc == 2 && !strcmp (argv[1], "seek"))
+    mode = SEEK;
+  else if (argc == 2 && !strcmp (argv[1], "pos"))
+    mode = POS;
+  else if (argc == 2 && !strcmp (argv[1], "vec"))
+    mode = VEC;
+  else
+    fail ("usage: vec-io seek|pos|vec");
+
+  CHECK (create ("vec-io.dat", RECORDS * RECORD_SIZE),
+         "create \"vec-io.dat\"");
+  CHECK ((fd = open ("vec-io.dat")) > 1, "open \"vec-io.dat\"");
+  for (round = 0; round < ROUNDS; round++)
+    for (r = 0; r < RECORDS; r++)
+      {
+        memset (fields, round * RECORDS + r, sizeof fields);
+        transfer (fd, fields, r, true, mode);
+        transfer (fd, check, r, false, mode);
+        if (memcmp (fields, check, sizeof fields))
+          fail ("record %d read back wrong", r);
+      }
+  close (fd);
+  msg ("%d rounds of %d records of %d fields", ROUNDS, RECORDS, FIELDS);
+  return 0;
+}
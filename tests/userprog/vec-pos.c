@@ -0,0 +1,49 @@
+/* Checks that pread(), pwrite(), preadv() and pwritev() leave the
+   file position alone, and that readv() and writev() advance it
+   by the bytes they move. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const int size = sizeof sample - 1;
+  char buf[64];
+  struct iovec iov[] = {{buf, 10}, {buf + 10, 10}};
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  msg ("pwrite: %d", pwrite (handle, sample, size, 0));
+  msg ("tell: %u", tell (handle));
+
+  seek (handle, 7);
+  msg ("pread: %d", pread (handle, buf, 20, 100));
+  compare_bytes (buf, sample + 100, 20, 100, "test.txt");
+  msg ("tell: %u", tell (handle));
+
+  msg ("preadv: %d", preadv (handle, iov, 2, 200));
+  compare_bytes (buf, sample + 200, 20, 200, "test.txt");
+  msg ("pwritev: %d", pwritev (handle, iov, 2, 200));
+  msg ("tell: %u", tell (handle));
+
+  msg ("readv: %d", readv (handle, iov, 2));
+  compare_bytes (buf, sample + 7, 20, 7, "test.txt");
+  msg ("tell: %u", tell (handle));
+
+  memcpy (buf, sample + 27, 10);
+  msg ("writev: %d", writev (handle, iov, 1));
+  msg ("tell: %u", tell (handle));
+
+  memcpy (buf, sample + 37, 10);
+  msg ("writev again: %d", writev (handle, iov, 1));
+  msg ("tell: %u", tell (handle));
+
+  seek (handle, 0);
+  check_file_handle (handle, "test.txt", sample, size);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vec-pos) begin
+(vec-pos) create "test.txt"
+(vec-pos) open "test.txt"
+(vec-pos) pwrite: 373
+(vec-pos) tell: 0
+(vec-pos) pread: 20
+(vec-pos) tell: 7
+(vec-pos) preadv: 20
+(vec-pos) pwritev: 20
+(vec-pos) tell: 7
+(vec-pos) readv: 20
+(vec-pos) tell: 27
+(vec-pos) writev: 10
+(vec-pos) tell: 37
+(vec-pos) writev again: 10
+(vec-pos) tell: 47
+(vec-pos) verified contents of "test.txt"
+(vec-pos) end
+vec-pos: exit(0)
+EOF
+pass;
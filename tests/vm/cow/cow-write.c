@@ -0,0 +1,58 @@
+/* Checks copy-on-write when three processes share a page and
+   each of them writes it in turn: a writer that still shares
+   the page gets a copy of its own, and the last process to
+   share it keeps the frame. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+void
+test_main (void)
+{
+	const char *buf = "Lorem ipsum";
+	void *pa_parent;
+	pid_t child;
+
+	CHECK (!memcmp (large, buf, strlen (buf)), "check data consistency");
+	pa_parent = get_phys_addr ((void *) large);
+
+	child = fork ("child");
+	if (child == 0) {
+		pid_t grandchild;
+
+		CHECK (!memcmp (large, buf, strlen (buf)), "child sees the data");
+		CHECK (get_phys_addr ((void *) large) == pa_parent,
+				"child shares the page");
+		grandchild = fork ("grandchild");
+		if (grandchild == 0) {
+			CHECK (!memcmp (large, buf, strlen (buf)),
+					"grandchild sees the data");
+			CHECK (get_phys_addr ((void *) large) == pa_parent,
+					"grandchild shares the page");
+			large[0] = '#';
+			CHECK (get_phys_addr ((void *) large) != pa_parent,
+					"grandchild's write copies the page");
+			CHECK (large[0] == '#' && !memcmp (large + 1, buf + 1,
+						strlen (buf) - 1),
+					"grandchild sees its write");
+			exit (0);
+		}
+		CHECK (wait (grandchild) == 0, "wait for grandchild");
+		CHECK (!memcmp (large, buf, strlen (buf)),
+				"child does not see grandchild's write");
+		large[0] = '@';
+		CHECK (get_phys_addr ((void *) large) != pa_parent,
+				"child's write copies the page");
+		exit (0);
+	}
+	CHECK (wait (child) == 0, "wait for child");
+	CHECK (!memcmp (large, buf, strlen (buf)),
+			"parent does not see the children's writes");
+	large[0] = '!';
+	CHECK (get_phys_addr ((void *) large) == pa_parent,
+			"parent's write keeps the page");
+	CHECK (large[0] == '!', "parent sees its write");
+}
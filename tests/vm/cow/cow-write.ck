@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-write) begin
+(cow-write) check data consistency
+(cow-write) child sees the data
+(cow-write) child shares the page
+(cow-write) grandchild sees the data
+(cow-write) grandchild shares the page
+(cow-write) grandchild's write copies the page
+(cow-write) grandchild sees its write
+(cow-write) wait for grandchild
+(cow-write) child does not see grandchild's write
+(cow-write) child's write copies the page
+(cow-write) wait for child
+(cow-write) parent does not see the children's writes
+(cow-write) parent's write keeps the page
+(cow-write) parent sees its write
+(cow-write) end
+EOF
+pass;
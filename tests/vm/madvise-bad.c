@@ -0,0 +1,40 @@
+/* Gives madvise() ranges that are not wholly file mappings, and
+   bad arguments, and checks that each call fails.  Then checks that
+   a good call succeeds and leaves the mapping's contents alone. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  char stack_obj[1];
+  void *stack_page = (void *) ((uintptr_t) stack_obj & ~(uintptr_t) 4095);
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 0, handle, 0) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+
+  CHECK (madvise ((void *) 0x20000000, 4096, MADV_RANDOM) == -1,
+         "madvise unmapped range");
+  CHECK (madvise (actual, 8192, MADV_RANDOM) == -1,
+         "madvise range running past mapping");
+  CHECK (madvise (stack_page, 4096, MADV_RANDOM) == -1,
+         "madvise stack page");
+  CHECK (madvise (actual + 1, 4096, MADV_RANDOM) == -1,
+         "madvise misaligned address");
+  CHECK (madvise ((void *) 0x8004000000, 4096, MADV_RANDOM) == -1,
+         "madvise kernel address");
+  CHECK (madvise (actual, 4096, 99) == -1, "madvise bad advice");
+
+  CHECK (madvise (actual, 4096, MADV_SEQUENTIAL) == 0,
+         "madvise mapping sequential");
+  CHECK (!memcmp (actual, sample, strlen (sample)),
+         "compare mapping against sample");
+}
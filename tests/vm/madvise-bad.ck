@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-bad) begin
+(madvise-bad) open "sample.txt"
+(madvise-bad) mmap "sample.txt"
+(madvise-bad) madvise unmapped range
+(madvise-bad) madvise range running past mapping
+(madvise-bad) madvise stack page
+(madvise-bad) madvise misaligned address
+(madvise-bad) madvise kernel address
+(madvise-bad) madvise bad advice
+(madvise-bad) madvise mapping sequential
+(madvise-bad) compare mapping against sample
+(madvise-bad) end
+EOF
+pass;
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-dontneed) begin
+(madvise-dontneed) create "sample.txt"
+(madvise-dontneed) open "sample.txt"
+(madvise-dontneed) mmap "sample.txt"
+(madvise-dontneed) madvise dontneed
+(madvise-dontneed) read "sample.txt"
+(madvise-dontneed) compare read data against written data
+(madvise-dontneed) compare mapping against written data
+(madvise-dontneed) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Writes a file through a mapping that spans a page boundary and,
+   without unmapping it, reads the data back with read(); then
+   writes with write() and reads it back through the mapping.
+   Both must see the other's data at once. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+/* Offset of the data, so that it spans the first two pages. */
+#define OFS 3900
+
+void
+test_main (void)
+{
+  size_t len = strlen (sample);
+  int map_handle, handle;
+  char buf[1024];
+  char *map;
+
+  CHECK (create ("coherent.txt", 8192), "create \"coherent.txt\"");
+  CHECK ((map_handle = open ("coherent.txt")) > 1, "open \"coherent.txt\"");
+  CHECK ((map = mmap (ACTUAL, 8192, 1, map_handle, 0)) != MAP_FAILED,
+         "mmap \"coherent.txt\"");
+  CHECK ((handle = open ("coherent.txt")) > 1,
+         "open \"coherent.txt\" again");
+
+  memcpy (map + OFS, sample, len);
+  seek (handle, OFS);
+  CHECK (read (handle, buf, len) == (int) len, "read \"coherent.txt\"");
+  CHECK (!memcmp (buf, sample, len), "read() sees the mapped writes");
+
+  memset (buf, 'x', len);
+  seek (handle, OFS);
+  CHECK (write (handle, buf, len) == (int) len, "write \"coherent.txt\"");
+  CHECK (!memcmp (map + OFS, buf, len), "mapping sees the write()");
+
+  munmap (map);
+  close (handle);
+  close (map_handle);
+}
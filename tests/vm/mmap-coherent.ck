@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-coherent) begin
+(mmap-coherent) create "coherent.txt"
+(mmap-coherent) open "coherent.txt"
+(mmap-coherent) mmap "coherent.txt"
+(mmap-coherent) open "coherent.txt" again
+(mmap-coherent) read "coherent.txt"
+(mmap-coherent) read() sees the mapped writes
+(mmap-coherent) write "coherent.txt"
+(mmap-coherent) mapping sees the write()
+(mmap-coherent) end
+EOF
+pass;
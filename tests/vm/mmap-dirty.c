@@ -0,0 +1,48 @@
+/* Maps large.txt writable, dirties every page, then either computes
+   for a while ("idle"), leaving the writeback thread time to write
+   the pages back, or calls msync() on the mapping ("msync"), before
+   unmapping it and checking the file.  Not a test: "make
+   writeback-bench" runs it with and without the writeback thread to
+   compare how long the munmap() takes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "mmap-dirty";
+
+#define ACTUAL ((char *) 0x10000000)
+#define IDLE_LOOPS 200000000
+
+int
+main (int argc, char *argv[])
+{
+  volatile unsigned spin = 0;
+  int handle;
+  size_t size, i;
+  char c;
+
+  if (argc != 2 || (strcmp (argv[1], "idle") && strcmp (argv[1], "msync")))
+    fail ("usage: mmap-dirty idle|msync");
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  size = filesize (handle);
+  CHECK (mmap (ACTUAL, size, 1, handle, 0) != MAP_FAILED,
+         "mmap \"large.txt\"");
+  for (i = 0; i < size; i += 4096)
+    ACTUAL[i] = 'x';
+
+  if (!strcmp (argv[1], "msync"))
+    CHECK (msync (ACTUAL, size) == 0, "msync \"large.txt\"");
+  else
+    for (i = 0; i < IDLE_LOOPS; i++)
+      spin++;
+
+  munmap (ACTUAL);
+  seek (handle, size - 1 - (size - 1) % 4096);
+  CHECK (read (handle, &c, 1) == 1 && c == 'x', "verify last page");
+  close (handle);
+  msg ("%s: dirtied %zu pages", argv[1], (size + 4095) / 4096);
+  return 0;
+}
@@ -0,0 +1,36 @@
+/* Maps 1 GB of large.txt, touches a few of its pages and unmaps it,
+   ROUNDS times over.  Not a test: "make vma-bench" runs it to show
+   that mapping and unmapping cost time and kernel memory in
+   proportion to the pages used, not to the size of the mapping. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "mmap-huge";
+
+#define ACTUAL ((char *) 0x100000000)
+#define SIZE (1024 * 1024 * 1024)
+#define ROUNDS 16
+#define TOUCHES 8
+
+int
+main (void)
+{
+  int handle, round, i;
+  unsigned sum = 0;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  for (round = 0; round < ROUNDS; round++)
+    {
+      if (mmap (ACTUAL, SIZE, 0, handle, 0) == MAP_FAILED)
+        fail ("mmap round %d", round);
+      /* The first page holds file data; the rest read as zeros. */
+      for (i = 0; i < TOUCHES; i++)
+        sum += ACTUAL[(size_t) SIZE / TOUCHES * i];
+      munmap (ACTUAL);
+    }
+  close (handle);
+  msg ("%d rounds of a 1 GB mapping: sum %u", ROUNDS, sum);
+  return 0;
+}
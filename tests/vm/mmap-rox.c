@@ -0,0 +1,30 @@
+/* Tries to map the executable of a running process writable, which
+   must fail, then maps it read-only and checks that it reads the
+   same bytes as read(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  int handle;
+  void *map;
+  char buf[16];
+
+  CHECK ((handle = open ("mmap-rox")) > 1, "open \"mmap-rox\"");
+  CHECK (mmap (ACTUAL, 4096, 1, handle, 0) == MAP_FAILED,
+         "try to mmap \"mmap-rox\" writable");
+  CHECK ((map = mmap (ACTUAL, 4096, 0, handle, 0)) != MAP_FAILED,
+         "mmap \"mmap-rox\" read-only");
+  CHECK (read (handle, buf, sizeof buf) == (int) sizeof buf,
+         "read \"mmap-rox\"");
+  CHECK (!memcmp (map, buf, sizeof buf),
+         "compare mapped data against read data");
+  munmap (map);
+  close (handle);
+}
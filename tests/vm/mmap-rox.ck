@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-rox) begin
+(mmap-rox) open "mmap-rox"
+(mmap-rox) try to mmap "mmap-rox" writable
+(mmap-rox) mmap "mmap-rox" read-only
+(mmap-rox) read "mmap-rox"
+(mmap-rox) compare mapped data against read data
+(mmap-rox) end
+EOF
+pass;
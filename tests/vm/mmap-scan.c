@@ -0,0 +1,61 @@
+/* Maps large.txt and reads one byte from each of its pages, PASSES
+   times over, either in order ("seq") or in a scattered order
+   ("rand"), after giving the mapping an access hint ("normal",
+   "random", "sequential" or "willneed").  Not a test: "make
+   madvise-bench" runs it with each combination to compare the
+   faults, reads and time each takes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "mmap-scan";
+
+#define ACTUAL ((char *) 0x10000000)
+#define PASSES 4
+
+static const char *advice_names[] = {
+  [MADV_NORMAL] = "normal",
+  [MADV_RANDOM] = "random",
+  [MADV_SEQUENTIAL] = "sequential",
+  [MADV_WILLNEED] = "willneed",
+};
+
+int
+main (int argc, char *argv[])
+{
+  int handle, advice, pass;
+  size_t size, pages, i;
+  unsigned sum = 0;
+  bool random;
+
+  if (argc != 3)
+    fail ("usage: mmap-scan seq|rand ADVICE");
+  random = !strcmp (argv[1], "rand");
+  for (advice = 0; advice <= MADV_WILLNEED; advice++)
+    if (!strcmp (argv[2], advice_names[advice]))
+      break;
+  if (advice > MADV_WILLNEED)
+    fail ("unknown advice \"%s\"", argv[2]);
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  size = filesize (handle);
+  pages = (size + 4095) / 4096;
+  CHECK (mmap (ACTUAL, size, 0, handle, 0) != MAP_FAILED, "mmap \"large.txt\"");
+  CHECK (madvise (ACTUAL, size, advice) == 0, "madvise %s", argv[2]);
+
+  for (pass = 0; pass < PASSES; pass++)
+    for (i = 0; i < pages; i++)
+      {
+        /* 257 is prime, so this visits every page once. */
+        size_t page = random ? (i * 257 + pass) % pages : i;
+        sum += ACTUAL[page * 4096];
+      }
+
+  munmap (ACTUAL);
+  close (handle);
+  msg ("%s scan of %zu pages, %d passes: sum %u", argv[1], pages, PASSES,
+       sum);
+  return 0;
+}
@@ -0,0 +1,62 @@
+/* Runs CHILDREN copies of itself that each map large.txt and read
+   every page of it, while the parent maps it too and reads it
+   through read().  Not a test: "make pagecache-bench" runs it to
+   show that the processes share one copy of the file in memory. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "mmap-share";
+
+#define ACTUAL ((char *) 0x10000000)
+#define CHILDREN 4
+
+/* Sums one byte of each page of large.txt, mapped at ACTUAL. */
+static unsigned
+scan (size_t size)
+{
+  unsigned sum = 0;
+  size_t i;
+
+  for (i = 0; i < size; i += 4096)
+    sum += ACTUAL[i];
+  return sum;
+}
+
+int
+main (int argc, char *argv[])
+{
+  static char buf[4096];
+  pid_t children[CHILDREN];
+  int handle, i;
+  size_t size;
+  unsigned sum;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  size = filesize (handle);
+  CHECK (mmap (ACTUAL, size, 0, handle, 0) != MAP_FAILED,
+         "mmap \"large.txt\"");
+  sum = scan (size);
+  if (argc == 2 && !strcmp (argv[1], "child"))
+    return sum % 256;
+
+  for (i = 0; i < CHILDREN; i++)
+    {
+      children[i] = fork ("mmap-share");
+      if (children[i] == 0)
+        {
+          exec ("mmap-share child");
+          fail ("exec \"mmap-share child\"");
+        }
+    }
+  while (read (handle, buf, sizeof buf) > 0)
+    continue;
+  for (i = 0; i < CHILDREN; i++)
+    CHECK (wait (children[i]) == (int) (sum % 256), "wait for child %d", i);
+  munmap (ACTUAL);
+  close (handle);
+  msg ("%d processes mapped %zu pages", CHILDREN + 1, (size + 4095) / 4096);
+  return 0;
+}
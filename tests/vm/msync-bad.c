@@ -0,0 +1,27 @@
+/* Gives msync() ranges that are not wholly file mappings, and bad
+   addresses, and checks that each call fails. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  char stack_obj[1];
+  void *stack_page = (void *) ((uintptr_t) stack_obj & ~(uintptr_t) 4095);
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 1, handle, 0) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+
+  CHECK (msync ((void *) 0x20000000, 4096) == -1, "msync unmapped range");
+  CHECK (msync (actual, 8192) == -1, "msync range running past mapping");
+  CHECK (msync (stack_page, 4096) == -1, "msync stack page");
+  CHECK (msync (actual + 1, 4096) == -1, "msync misaligned address");
+  CHECK (msync ((void *) 0x8004000000, 4096) == -1, "msync kernel address");
+  CHECK (msync (actual, 4096) == 0, "msync mapping");
+}
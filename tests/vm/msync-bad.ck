@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(msync-bad) begin
+(msync-bad) open "sample.txt"
+(msync-bad) mmap "sample.txt"
+(msync-bad) msync unmapped range
+(msync-bad) msync range running past mapping
+(msync-bad) msync stack page
+(msync-bad) msync misaligned address
+(msync-bad) msync kernel address
+(msync-bad) msync mapping
+(msync-bad) end
+EOF
+pass;
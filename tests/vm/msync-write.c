@@ -0,0 +1,36 @@
+/* Writes to a file through a mapping and calls msync(), then reads
+   the file back with read() while it is still mapped, twice, to
+   check that msync() reaches the file each time. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  size_t size = strlen (sample);
+  char buf[1024];
+  int handle;
+
+  CHECK (create ("sample.txt", size), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 1, handle, 0) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+
+  memcpy (actual, sample, size);
+  CHECK (msync (actual, 4096) == 0, "msync");
+  CHECK (read (handle, buf, size) == (int) size, "read \"sample.txt\"");
+  CHECK (!memcmp (buf, sample, size),
+         "compare read data against written data");
+
+  memset (actual, 'x', size);
+  CHECK (msync (actual, 4096) == 0, "msync again");
+  seek (handle, 0);
+  CHECK (read (handle, buf, size) == (int) size, "read \"sample.txt\" again");
+  CHECK (buf[0] == 'x' && !memcmp (buf, buf + 1, size - 1),
+         "compare read data against rewritten data");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(msync-write) begin
+(msync-write) create "sample.txt"
+(msync-write) open "sample.txt"
+(msync-write) mmap "sample.txt"
+(msync-write) msync
+(msync-write) read "sample.txt"
+(msync-write) compare read data against written data
+(msync-write) msync again
+(msync-write) read "sample.txt" again
+(msync-write) compare read data against rewritten data
+(msync-write) end
+EOF
+pass;
@@ -0,0 +1,67 @@
+/* Checks that anonymous pages come back intact from compressed
+ * swap.  The pages are of four kinds: filled with one nonzero
+ * byte, filled with zeros, compressible, and incompressible, so
+ * that some are kept as a single word, some compressed, and some
+ * written to the swap disk.  There are more of them than fit in
+ * memory, so most of them are swapped out and back in. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (16 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char big_chunks[CHUNK_SIZE];
+
+/* Returns byte J of page I. */
+static char
+expected (size_t i, size_t j)
+{
+	uint32_t x;
+
+	switch (i % 4) {
+	case 0:
+		return (char) (i | 1);
+	case 1:
+		return 0;
+	case 2:
+		return 'a' + (i + j / 64) % 26;
+	default:
+		x = i * PAGE_SIZE + j;
+		x ^= x >> 16;
+		x *= 0x7feb352d;
+		x ^= x >> 15;
+		x *= 0x846ca68b;
+		x ^= x >> 16;
+		return x;
+	}
+}
+
+void
+test_main (void)
+{
+	size_t i, j;
+
+	for (i = 0; i < PAGE_COUNT; i++) {
+		char *page = big_chunks + i * PAGE_SIZE;
+
+		if (i % 512 == 0)
+			msg ("write page %zu", i);
+		for (j = 0; j < PAGE_SIZE; j++)
+			page[j] = expected (i, j);
+	}
+
+	for (i = 0; i < PAGE_COUNT; i++) {
+		char *page = big_chunks + i * PAGE_SIZE;
+
+		for (j = 0; j < PAGE_SIZE; j++)
+			if (page[j] != expected (i, j))
+				fail ("byte %zu of page %zu is %d instead of %d",
+						j, i, page[j], expected (i, j));
+		if (i % 512 == 0)
+			msg ("check page %zu", i);
+	}
+}
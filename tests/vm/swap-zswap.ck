@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-zswap) begin
+(swap-zswap) write page 0
+(swap-zswap) write page 512
+(swap-zswap) write page 1024
+(swap-zswap) write page 1536
+(swap-zswap) write page 2048
+(swap-zswap) write page 2560
+(swap-zswap) write page 3072
+(swap-zswap) write page 3584
+(swap-zswap) check page 0
+(swap-zswap) check page 512
+(swap-zswap) check page 1024
+(swap-zswap) check page 1536
+(swap-zswap) check page 2048
+(swap-zswap) check page 2560
+(swap-zswap) check page 3072
+(swap-zswap) check page 3584
+(swap-zswap) end
+EOF
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my ($line) = grep (/^Zswap: \d+ stored/, @output);
+fail "missing Zswap statistics\n" if !defined $line;
+my ($stored, $same, $loaded)
+  = $line =~ /^Zswap: (\d+) stored \((\d+) same-filled\), \d+ rejected, (\d+) loaded/;
+fail "no same-filled page went to zswap\n" if !$same;
+fail "no compressed page went to zswap\n" if $stored <= $same;
+fail "no page came back from zswap\n" if !$loaded;
+pass;
@@ -0,0 +1,60 @@
+/* Runs N copies of itself at once, each reading every page of a
+   large read-only table in its own text segment and then computing
+   for a while before it exits.  Not a test: "make text-bench" runs
+   it for several N to show the memory the copies take and how long
+   each exec takes to load. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "text-share";
+
+#define MAX_INSTANCES 32
+#define SPIN_LOOPS 20000000
+
+/* Read-only data, loaded with the code from the executable. */
+static const char table[256 * 1024] = { 1 };
+
+/* Sums one byte of each page of TABLE, then spins. */
+static int
+run (void)
+{
+  volatile unsigned spin = 0;
+  unsigned sum = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof table; i += 4096)
+    sum += ((volatile const char *) table)[i];
+  for (i = 0; i < SPIN_LOOPS; i++)
+    spin++;
+  return sum;
+}
+
+int
+main (int argc, char *argv[])
+{
+  pid_t children[MAX_INSTANCES];
+  int instances, i;
+
+  if (argc == 2 && !strcmp (argv[1], "child"))
+    return run ();
+  if (argc != 2 || (instances = atoi (argv[1])) < 1
+      || instances > MAX_INSTANCES)
+    fail ("usage: text-share N, with N from 1 to %d", MAX_INSTANCES);
+
+  for (i = 0; i < instances; i++)
+    {
+      children[i] = fork ("text-share");
+      if (children[i] == 0)
+        {
+          exec ("text-share child");
+          fail ("exec \"text-share child\"");
+        }
+    }
+  for (i = 0; i < instances; i++)
+    CHECK (wait (children[i]) == 1, "wait for instance %d", i);
+  msg ("%d instances of %zu kB of text", instances, sizeof table / 1024);
+  return 0;
+}
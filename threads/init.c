@@ -19,11 +19,15 @@
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vmalloc.h"
 #include "threads/pte.h"
+#include "intrinsic.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/exec_cache.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
@@ -31,6 +35,7 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -85,7 +90,9 @@ main (void) {
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	slab_init ();
 	paging_init (mem_end);
+	vmalloc_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -100,6 +107,7 @@ main (void) {
 #ifdef USERPROG
 	exception_init ();
 	syscall_init ();
+	exec_cache_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
@@ -152,19 +160,38 @@ paging_init (uint64_t mem_end) {
 	extern char start, _end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	// Every 2 MB that lies wholly below mem_end and holds no kernel
+	// text is mapped with one superpage; the rest with 4 kB pages,
+	// so that the text stays read-only.
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
-		perm = PTE_P | PTE_W;
+		if (pa % LARGE_PGSIZE == 0 && pa + LARGE_PGSIZE <= mem_end
+				&& (va + LARGE_PGSIZE <= (uint64_t) &start
+					|| va >= (uint64_t) &_end_kernel_text)) {
+			if (!kern_set_large_page ((void *) va, pa, true))
+				PANIC ("paging_init: out of memory");
+			pa += LARGE_PGSIZE;
+			continue;
+		}
+
+		perm = PTE_G | PTE_P | PTE_W;
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
 	pml4_activate(0);
+	tlb_init ();
+
+	/* Make kernel writes honor read-only user mappings, so that a
+	 * system call writing into a page shared copy-on-write faults
+	 * and gets a private copy instead of writing through. */
+	lcr0 (rcr0 () | CR0_WP);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -221,11 +248,31 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-nopcid"))
+			mmu_use_pcid = false;
+		else if (!strcmp (name, "-nopge"))
+			mmu_use_pge = false;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
+		else if (!strcmp (name, "-noexeccache"))
+			exec_cache_enabled = false;
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-vmpolicy")) {
+			if (value == NULL || !vm_select_policy (value))
+				PANIC ("unknown page replacement policy `%s'", value);
+		}
+		else if (!strcmp (name, "-zswap"))
+			zswap_percent = atoi (value);
+		else if (!strcmp (name, "-nothp"))
+			vm_thp = false;
+		else if (!strcmp (name, "-faultaround"))
+			vm_fault_around = atoi (value);
+		else if (!strcmp (name, "-writeback"))
+			vm_writeback_rate = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -326,8 +373,21 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -nopcid            Flush the TLB on every address space switch.\n"
+			"  -nopge             Flush kernel TLB entries on every switch too.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -noexeccache       Parse every executable's headers on exec.\n"
+#endif
+#ifdef VM
+			"  -vmpolicy=NAME     Use page replacement policy NAME\n"
+			"                     (clock, 2q or clockpro).\n"
+			"  -zswap=PERCENT     Let compressed swap use up to PERCENT of\n"
+			"                     user memory (default 20, 0 disables).\n"
+			"  -nothp             Map user memory with 4 kB pages only.\n"
+			"  -faultaround=N     Load up to N file pages per page fault.\n"
+			"  -writeback=N       Write back up to N dirty mapped pages per\n"
+			"                     second (default 1024, 0 disables).\n"
 #endif
 			);
 	power_off ();
@@ -361,5 +421,12 @@ print_stats (void) {
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	process_print_stats ();
+#endif
+	malloc_stats ();
+	slab_print_stats ();
+	mmu_print_stats ();
+#ifdef VM
+	vm_print_stats ();
 #endif
 }
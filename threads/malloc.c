@@ -5,17 +5,23 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vmalloc.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  Size classes are spaced 8 bytes
+   apart up to 64 bytes and then eight per power of two (64, 72,
+   ..., 120, 128, 144, ...), so that no request wastes more than
+   about 12.5% of its block.  The descriptor keeps a list of free
+   blocks.  If the free list is nonempty, one of its blocks is
+   used to satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
    obtained from the page allocator (if none is available,
@@ -28,11 +34,26 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
+   Each descriptor's free list is protected by a lock, which every
+   thread in the kernel would otherwise contend on.  To keep the
+   common case off that lock, each thread also has a small cache
+   of free blocks per size class (struct malloc_tcache).  malloc()
+   pops from it and free() pushes onto it without locking, since
+   only the owning thread ever touches it; the descriptor lock is
+   taken only to refill or drain the cache TCACHE_BATCH blocks at
+   a time.  Blocks sitting in a thread cache count as in use from
+   the arena's point of view, and the cache is drained when the
+   thread exits.
+
+   We can't handle blocks bigger than about 2 kB using this
+   scheme, because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.  When the
+   kernel pool is too fragmented to supply that many contiguous
+   pages, we fall back to vmalloc(), which maps scattered pages
+   at contiguous virtual addresses; free() tells the two apart by
+   address. */
 
 /* Descriptor. */
 struct desc {
@@ -40,6 +61,10 @@ struct desc {
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+
+	/* Statistics, protected by LOCK. */
+	size_t arena_cnt;           /* Arenas currently held. */
+	size_t free_cnt;            /* Blocks on FREE_LIST. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -57,89 +82,165 @@ struct block {
 	struct list_elem free_elem; /* Free list element. */
 };
 
+/* Maximum number of descriptors. */
+#define DESC_MAX 48
+
+/* Largest block a descriptor hands out: two per arena. */
+#define MAX_BLOCK_SIZE \
+	ROUND_DOWN ((PGSIZE - sizeof (struct arena)) / 2, 8)
+
+/* Free block in a thread cache. */
+struct tblock {
+	struct tblock *next;        /* Next cached block. */
+};
+
+/* Per-thread cache of free blocks, one bin per descriptor. */
+#define TCACHE_MAX 16           /* Blocks a bin may hold. */
+#define TCACHE_BATCH 8          /* Blocks moved per refill or drain. */
+
+struct malloc_tcache {
+	struct {
+		struct tblock *head;    /* Cached blocks. */
+		size_t cnt;             /* Number of cached blocks. */
+	} bins[DESC_MAX];
+	uint64_t requested;         /* Bytes requested through malloc(). */
+	uint64_t granted;           /* Bytes handed out for them. */
+};
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[DESC_MAX]; /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Maps (SIZE + 7) / 8 to the index of the smallest descriptor
+   whose blocks hold SIZE bytes. */
+static uint8_t size_to_desc[MAX_BLOCK_SIZE / 8 + 1];
+
+/* Statistics not owned by any descriptor, protected by
+   stats_lock. */
+static struct lock stats_lock;
+static size_t big_cnt;          /* Big blocks currently allocated. */
+static size_t big_pages;        /* Pages held by big blocks. */
+static size_t big_contig_cnt;   /* Big blocks served by palloc. */
+static size_t big_vmap_cnt;     /* Big blocks served by vmalloc. */
+static size_t big_fail_cnt;     /* Big block requests that failed. */
+static uint64_t exited_requested; /* Totals of exited threads' caches. */
+static uint64_t exited_granted;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static size_t desc_get_blocks (struct desc *, struct tblock **, size_t cnt);
+static void desc_put_blocks (struct desc *, struct tblock *);
+static struct malloc_tcache *tcache_get (void);
+static void tcache_drain (struct desc *, struct malloc_tcache *, size_t cnt);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t block_size, step, i, j;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+	block_size = 16;
+	for (;;) {
 		struct desc *d = &descs[desc_cnt++];
 		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
 		lock_init (&d->lock);
+		d->arena_cnt = d->free_cnt = 0;
+		if (block_size == MAX_BLOCK_SIZE)
+			break;
+
+		/* Step by 8 below 64 bytes, then by an eighth of the
+		   enclosing power of two. */
+		for (step = 8; block_size >= step * 16; step *= 2)
+			continue;
+		block_size += step;
+		if (block_size > MAX_BLOCK_SIZE)
+			block_size = MAX_BLOCK_SIZE;
 	}
+
+	for (i = j = 0; i < sizeof size_to_desc; i++) {
+		while (descs[j].block_size < i * 8)
+			j++;
+		size_to_desc[i] = j;
+	}
+
+	lock_init (&stats_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+	struct malloc_tcache *tc;
+	struct tblock *b;
 	struct desc *d;
-	struct block *b;
 	struct arena *a;
+	size_t idx;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
 		return NULL;
 
-	/* Find the smallest descriptor that satisfies a SIZE-byte
-	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	if (size > MAX_BLOCK_SIZE) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
+		bool vmapped = false;
+
 		a = palloc_get_multiple (0, page_cnt);
-		if (a == NULL)
+		if (a == NULL && page_cnt > 1) {
+			a = vmalloc (0, page_cnt);
+			vmapped = true;
+		}
+		if (a == NULL) {
+			lock_acquire (&stats_lock);
+			big_fail_cnt++;
+			lock_release (&stats_lock);
 			return NULL;
+		}
 
 		/* Initialize the arena to indicate a big block of PAGE_CNT
 		   pages, and return it. */
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+
+		lock_acquire (&stats_lock);
+		big_cnt++;
+		big_pages += page_cnt;
+		if (vmapped)
+			big_vmap_cnt++;
+		else
+			big_contig_cnt++;
+		lock_release (&stats_lock);
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
+	/* Find the smallest descriptor that satisfies a SIZE-byte
+	   request. */
+	idx = size_to_desc[DIV_ROUND_UP (size, 8)];
+	d = &descs[idx];
 
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
+	tc = tcache_get ();
+	if (tc == NULL) {
+		/* No thread cache: go straight to the descriptor. */
+		return desc_get_blocks (d, &b, 1) ? b : NULL;
+	}
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
+	if (tc->bins[idx].head == NULL) {
+		tc->bins[idx].cnt = desc_get_blocks (d, &tc->bins[idx].head,
+				TCACHE_BATCH);
+		if (tc->bins[idx].head == NULL)
 			return NULL;
-		}
-
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
 	}
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
+	/* Fast path: pop a cached block. */
+	b = tc->bins[idx].head;
+	tc->bins[idx].head = b->next;
+	tc->bins[idx].cnt--;
+	tc->requested += size;
+	tc->granted += d->block_size;
 	return b;
 }
 
@@ -201,44 +302,277 @@ realloc (void *old_block, size_t new_size) {
 void
 free (void *p) {
 	if (p != NULL) {
-		struct block *b = p;
-		struct arena *a = block_to_arena (b);
+		struct tblock *b = p;
+		struct arena *a = block_to_arena (p);
 		struct desc *d = a->desc;
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			struct malloc_tcache *tc;
+			size_t idx = d - descs;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			tc = tcache_get ();
+			if (tc == NULL) {
+				b->next = NULL;
+				desc_put_blocks (d, b);
+				return;
 			}
 
-			lock_release (&d->lock);
+			/* Fast path: push onto the thread cache, draining half
+			   of it back to the descriptor if it is full. */
+			if (tc->bins[idx].cnt >= TCACHE_MAX)
+				tcache_drain (d, tc, TCACHE_BATCH);
+			b->next = tc->bins[idx].head;
+			tc->bins[idx].head = b;
+			tc->bins[idx].cnt++;
 		} else {
 			/* It's a big block.  Free its pages. */
-			palloc_free_multiple (a, a->free_cnt);
+			lock_acquire (&stats_lock);
+			big_cnt--;
+			big_pages -= a->free_cnt;
+			lock_release (&stats_lock);
+			if (is_vmalloc_vaddr (a))
+				vfree (a, a->free_cnt);
+			else
+				palloc_free_multiple (a, a->free_cnt);
 			return;
 		}
 	}
 }
-
+
+/* Returns every block cached by the running thread to its
+   descriptor and frees the cache.  Called from thread_exit(). */
+void
+malloc_thread_exit (void) {
+	struct thread *t = thread_current ();
+	struct malloc_tcache *tc = t->tcache;
+	size_t i;
+
+	if (tc == NULL)
+		return;
+
+	for (i = 0; i < desc_cnt; i++)
+		tcache_drain (&descs[i], tc, tc->bins[i].cnt);
+
+	lock_acquire (&stats_lock);
+	exited_requested += tc->requested;
+	exited_granted += tc->granted;
+	lock_release (&stats_lock);
+
+	/* The cache itself came straight from its descriptor. */
+	t->tcache = NULL;
+	desc_put_blocks (&descs[size_to_desc[DIV_ROUND_UP (sizeof *tc, 8)]],
+			(struct tblock *) tc);
+}
+
+/* Totals gathered from every live thread's cache. */
+struct tcache_totals {
+	size_t cached[DESC_MAX];
+	uint64_t requested;
+	uint64_t granted;
+};
+
+static void
+tcache_sum (struct thread *t, void *totals_) {
+	struct tcache_totals *totals = totals_;
+	struct malloc_tcache *tc = t->tcache;
+	size_t i;
+
+	if (tc == NULL)
+		return;
+	for (i = 0; i < desc_cnt; i++)
+		totals->cached[i] += tc->bins[i].cnt;
+	totals->requested += tc->requested;
+	totals->granted += tc->granted;
+}
+
+/* Prints per-class usage, the number of arenas held and the
+   amount of memory lost to fragmentation.
+
+   Internal fragmentation is the share of bytes handed out by
+   malloc() beyond what callers asked for, over the kernel's
+   lifetime.  External fragmentation is the share of arena space
+   holding free blocks, whether on a descriptor's free list or in
+   some thread's cache. */
+void
+malloc_stats (void) {
+	static struct tcache_totals totals;
+	size_t arenas = 0, arena_bytes = 0, idle_bytes = 0;
+	enum intr_level old_level;
+	size_t i;
+
+	memset (&totals, 0, sizeof totals);
+	old_level = intr_disable ();
+	thread_foreach (tcache_sum, &totals);
+	intr_set_level (old_level);
+
+	lock_acquire (&stats_lock);
+	totals.requested += exited_requested;
+	totals.granted += exited_granted;
+	lock_release (&stats_lock);
+
+	printf ("Malloc: %5s %6s %7s %6s %6s\n",
+			"size", "arenas", "in-use", "free", "cached");
+	for (i = 0; i < desc_cnt; i++) {
+		struct desc *d = &descs[i];
+		size_t arena_cnt, free_cnt, total;
+
+		lock_acquire (&d->lock);
+		arena_cnt = d->arena_cnt;
+		free_cnt = d->free_cnt;
+		lock_release (&d->lock);
+
+		if (arena_cnt == 0)
+			continue;
+		total = arena_cnt * d->blocks_per_arena;
+		printf ("Malloc: %5zu %6zu %7zu %6zu %6zu\n", d->block_size,
+				arena_cnt, total - free_cnt - totals.cached[i], free_cnt,
+				totals.cached[i]);
+
+		arenas += arena_cnt;
+		arena_bytes += arena_cnt * PGSIZE;
+		idle_bytes += (free_cnt + totals.cached[i]) * d->block_size;
+	}
+
+	lock_acquire (&stats_lock);
+	printf ("Malloc: %zu arenas, %zu big blocks in %zu pages\n",
+			arenas, big_cnt, big_pages);
+	printf ("Malloc: big requests %zu contiguous, %zu vmapped, %zu failed\n",
+			big_contig_cnt, big_vmap_cnt, big_fail_cnt);
+	lock_release (&stats_lock);
+	printf ("Malloc: fragmentation %llu%% internal, %zu%% external\n",
+			(unsigned long long) (totals.granted
+			? (totals.granted - totals.requested) * 100 / totals.granted : 0),
+			arena_bytes ? idle_bytes * 100 / arena_bytes : 0);
+}
+
+/* Takes up to CNT blocks from descriptor D, creating arenas as
+   needed, and chains them onto *LIST.  Returns the number of
+   blocks obtained, which is less than CNT only if the page
+   allocator ran out of pages. */
+static size_t
+desc_get_blocks (struct desc *d, struct tblock **list, size_t cnt) {
+	size_t got;
+
+	*list = NULL;
+	lock_acquire (&d->lock);
+	for (got = 0; got < cnt; got++) {
+		struct tblock *tb;
+		struct block *b;
+		struct arena *a;
+
+		/* If the free list is empty, create a new arena. */
+		if (list_empty (&d->free_list)) {
+			size_t i;
+
+			/* Allocate a page. */
+			a = palloc_get_page (0);
+			if (a == NULL)
+				break;
+
+			/* Initialize arena and add its blocks to the free list. */
+			a->magic = ARENA_MAGIC;
+			a->desc = d;
+			a->free_cnt = d->blocks_per_arena;
+			for (i = 0; i < d->blocks_per_arena; i++) {
+				struct block *b = arena_to_block (a, i);
+				list_push_back (&d->free_list, &b->free_elem);
+			}
+			d->arena_cnt++;
+			d->free_cnt += d->blocks_per_arena;
+		}
+
+		/* Get a block from free list. */
+		b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+		a = block_to_arena (b);
+		a->free_cnt--;
+		d->free_cnt--;
+
+		tb = (struct tblock *) b;
+		tb->next = *list;
+		*list = tb;
+	}
+	lock_release (&d->lock);
+	return got;
+}
+
+/* Returns the chain of blocks LIST to descriptor D, releasing
+   any arena that becomes entirely unused. */
+static void
+desc_put_blocks (struct desc *d, struct tblock *list) {
+	lock_acquire (&d->lock);
+	while (list != NULL) {
+		struct block *b = (struct block *) list;
+		struct arena *a = block_to_arena (b);
+
+		list = list->next;
+
+		/* Add block to free list. */
+		list_push_front (&d->free_list, &b->free_elem);
+		d->free_cnt++;
+
+		/* If the arena is now entirely unused, free it. */
+		if (++a->free_cnt >= d->blocks_per_arena) {
+			size_t i;
+
+			ASSERT (a->free_cnt == d->blocks_per_arena);
+			for (i = 0; i < d->blocks_per_arena; i++) {
+				struct block *b = arena_to_block (a, i);
+				list_remove (&b->free_elem);
+			}
+			d->arena_cnt--;
+			d->free_cnt -= d->blocks_per_arena;
+			palloc_free_page (a);
+		}
+	}
+	lock_release (&d->lock);
+}
+
+/* Returns the running thread's block cache, creating it on first
+   use.  Returns a null pointer if it cannot be created. */
+static struct malloc_tcache *
+tcache_get (void) {
+	struct thread *t = thread_current ();
+	struct tblock *b;
+
+	if (t->tcache == NULL) {
+		struct desc *d = &descs[size_to_desc[DIV_ROUND_UP (
+				sizeof (struct malloc_tcache), 8)]];
+		if (desc_get_blocks (d, &b, 1) == 0)
+			return NULL;
+		memset (b, 0, sizeof (struct malloc_tcache));
+		t->tcache = (struct malloc_tcache *) b;
+	}
+	return t->tcache;
+}
+
+/* Moves CNT blocks from TC's bin for descriptor D back to D. */
+static void
+tcache_drain (struct desc *d, struct malloc_tcache *tc, size_t cnt) {
+	size_t idx = d - descs;
+	struct tblock *head, **tail;
+	size_t i;
+
+	ASSERT (cnt <= tc->bins[idx].cnt);
+	if (cnt == 0)
+		return;
+
+	head = tc->bins[idx].head;
+	tail = &head;
+	for (i = 0; i < cnt; i++)
+		tail = &(*tail)->next;
+	tc->bins[idx].head = *tail;
+	tc->bins[idx].cnt -= cnt;
+	*tail = NULL;
+
+	desc_put_blocks (d, head);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -1,58 +1,194 @@
+#include <bitmap.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers
+ *
+ * Without PCIDs every CR3 load flushes the TLB.  With them, each
+ * TLB entry is tagged with the PCID that was in CR3 when it was
+ * filled, so a process's translations survive switches to other
+ * processes and back.  base_pml4, which maps no user memory, uses
+ * PCID 0.  Every other pml4 gets a PCID of its own on first
+ * activation and gives it back when it is destroyed; if they run
+ * out, the rest share PCID 0 and flush on every activation.
+ *
+ * Entries of an inactive pml4 can go stale: another thread may
+ * unmap one of its pages, and a recycled PCID may still tag the
+ * entries of its previous owner.  invlpg only reaches the current
+ * PCID, so instead the PCID is marked and flushed the next time its
+ * pml4 is activated.  A PCID is fresh while its PCID_GEN equals
+ * TLB_GEN; marking one stale zeroes it, and a change to kernel
+ * mappings, which every PCID may cache, bumps TLB_GEN.
+ *
+ * A pml4's PCID is kept in an unused top-level entry of the pml4
+ * itself, which stays not present so that the CPU ignores it.
+ *
+ * Global pages
+ *
+ * Kernel mappings are the same in every address space, so they are
+ * marked PTE_G and, with CR4.PGE set, survive CR3 loads: a process
+ * switch no longer costs the kernel its TLB entries, with or without
+ * PCIDs.  invlpg removes a global entry from every PCID, so a change
+ * to one kernel page needs nothing more.  A change to many at once
+ * is cheaper with tlb_flush_all(), which toggles CR4.PGE; a plain
+ * CR3 load would leave global entries behind.  Without PGE, kernel
+ * entries are cached per PCID and a change bumps TLB_GEN instead. */
+#define PCID_CNT 4096
+#define PML4_META 511                   /* Entry holding the PCID. */
+#define META_PCID_SHIFT 12
+#define META_NO_PCID 0x2                /* Shares PCID 0; always flush. */
+
+/* Set to false by -nopcid and -nopge. */
+bool mmu_use_pcid = true;
+bool mmu_use_pge = true;
+
+static bool pcid_enabled;
+static bool pge_enabled;
+static struct bitmap *pcid_map;         /* PCIDs in use. */
+static uint8_t pcid_map_buf[PCID_CNT / 8 + 64];
+static uint32_t pcid_gen[PCID_CNT];
+static uint32_t tlb_gen = 1;
+
+/* TLB statistics. */
+static struct {
+	unsigned long long loads;           /* CR3 loads. */
+	unsigned long long flushes;         /* CR3 loads that flushed. */
+	unsigned long long assigned;        /* PCIDs handed out. */
+	unsigned long long overflows;       /* pml4s left without a PCID. */
+	unsigned long long full_flushes;    /* tlb_flush_all() calls. */
+} tlb_stats;
+
+static bool pml4_is_active (uint64_t *pml4);
+
+/* Page-table statistics. */
+static struct {
+	size_t pt_pages;                /* Paging structure pages in use. */
+	size_t peak_pt_pages;           /* Maximum of PT_PAGES. */
+	size_t kern_large;              /* Kernel superpages mapped. */
+	unsigned long long user_large;  /* User superpages mapped. */
+	unsigned long long splits;      /* Superpages split into pages. */
+} mmu_stats;
+
+/* Allocates a zeroed page for a paging structure. */
 static uint64_t *
-pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
-	int idx = PDX (va);
-	if (pdp) {
-		uint64_t *pte = (uint64_t *) pdp[idx];
-		if (!((uint64_t) pte & PTE_P)) {
-			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
-				if (new_page)
-					pdp[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
-				else
-					return NULL;
-			} else
-				return NULL;
-		}
-		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
-	}
-	return NULL;
+pt_alloc (void) {
+	uint64_t *page = palloc_get_page (PAL_ZERO);
+	if (page != NULL && ++mmu_stats.pt_pages > mmu_stats.peak_pt_pages)
+		mmu_stats.peak_pt_pages = mmu_stats.pt_pages;
+	return page;
 }
 
+/* Frees paging structure page PAGE. */
+static void
+pt_free (void *page) {
+	palloc_free_page (page);
+	mmu_stats.pt_pages--;
+}
+
+/* A page table set aside when a user superpage is mapped, so that
+ * splitting the superpage later, which eviction and munmap do under
+ * memory pressure, never has to allocate memory.  Until the split
+ * fills the table in, its first bytes hold this record. */
+struct spare_pt {
+	struct spare_pt *next;      /* Next spare table. */
+	uint64_t *pde;              /* The superpage's directory entry. */
+};
+static struct spare_pt *spare_pts;
+
+/* Sets aside PT, a page table, for splitting the superpage mapped
+ * by *PDE. */
+static void
+spare_add (uint64_t *pde, uint64_t *pt) {
+	struct spare_pt *spare = (struct spare_pt *) pt;
+	enum intr_level old_level = intr_disable ();
+
+	spare->pde = pde;
+	spare->next = spare_pts;
+	spare_pts = spare;
+	intr_set_level (old_level);
+}
+
+/* Returns the page table set aside for the superpage mapped by *PDE,
+ * zeroed, or a null pointer if there is none. */
 static uint64_t *
-pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
-	uint64_t *pte = NULL;
-	int idx = PDPE (va);
-	int allocated = 0;
-	if (pdpe) {
-		uint64_t *pde = (uint64_t *) pdpe[idx];
-		if (!((uint64_t) pde & PTE_P)) {
-			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
-				if (new_page) {
-					pdpe[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
-					allocated = 1;
-				} else
-					return NULL;
-			} else
-				return NULL;
+spare_take (uint64_t *pde) {
+	struct spare_pt **p, *spare = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	for (p = &spare_pts; *p != NULL; p = &(*p)->next)
+		if ((*p)->pde == pde) {
+			spare = *p;
+			*p = spare->next;
+			break;
 		}
-		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
+	intr_set_level (old_level);
+	if (spare != NULL)
+		memset (spare, 0, sizeof *spare);
+	return (uint64_t *) spare;
+}
+
+/* Returns the table that entry *E points to.  If *E is not present
+ * and CREATE is true, installs a new, empty table and sets
+ * *ALLOCATED; otherwise returns a null pointer. */
+static uint64_t *
+next_table (uint64_t *e, int create, bool *allocated) {
+	if (!(*e & PTE_P)) {
+		uint64_t *new_page;
+		if (!create || (new_page = pt_alloc ()) == NULL)
+			return NULL;
+		*e = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		*allocated = true;
 	}
-	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pdpe[idx])));
-		pdpe[idx] = 0;
+	return ptov (PTE_ADDR (*e));
+}
+
+/* Returns the address of the page directory entry for virtual
+ * address VA in page map level 4 PML4.  If the page directory
+ * pointer table or the page directory for VA is missing, creates
+ * them if CREATE is true and otherwise returns a null pointer. */
+uint64_t *
+pde_walk (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *pdpt, *pd;
+	bool allocated = false, unused;
+
+	pdpt = next_table (&pml4[PML4 (va)], create, &allocated);
+	if (pdpt == NULL)
+		return NULL;
+	pd = next_table (&pdpt[PDPE (va)], create, &unused);
+	if (pd == NULL && allocated) {
+		pt_free (pdpt);
+		pml4[PML4 (va)] = 0;
 	}
-	return pte;
+	return pd != NULL ? &pd[PDX (va)] : NULL;
+}
+
+/* Replaces the superpage mapped by *PDE in PML4, which contains VA,
+ * with a page table mapping the same frames with the same
+ * permissions, using the table set aside for it if there is one.
+ * Returns false if out of memory. */
+static bool
+large_split (uint64_t *pml4, uint64_t *pde, const uint64_t va) {
+	uint64_t *pt = spare_take (pde);
+	uint64_t pa = PTE_ADDR (*pde);
+	uint64_t flags = *pde & PTE_FLAGS & ~PTE_PS;
+
+	if (pt == NULL && (pt = pt_alloc ()) == NULL)
+		return false;
+	for (unsigned i = 0; i < LARGE_PGCNT; i++)
+		pt[i] = (pa + (uint64_t) i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	pml4_invalidate (pml4, (void *) va);
+	mmu_stats.splits++;
+	return true;
 }
 
 /* Returns the address of the page table entry for virtual
@@ -60,32 +196,25 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
  * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
+ * pointer is returned.
+ * If VADDR lies in a superpage and CREATE is false, returns its
+ * page directory entry, which has PTE_PS set; if CREATE is true,
+ * the superpage is split into 4 kB pages first. */
 uint64_t *
 pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
-	uint64_t *pte = NULL;
-	int idx = PML4 (va);
-	int allocated = 0;
-	if (pml4e) {
-		uint64_t *pdpe = (uint64_t *) pml4e[idx];
-		if (!((uint64_t) pdpe & PTE_P)) {
-			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
-				if (new_page) {
-					pml4e[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
-					allocated = 1;
-				} else
-					return NULL;
-			} else
-				return NULL;
-		}
-		pte = pdpe_walk (ptov (PTE_ADDR (pml4e[idx])), va, create);
-	}
-	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pml4e[idx])));
-		pml4e[idx] = 0;
+	uint64_t *pde = pde_walk (pml4e, va, create);
+	bool unused;
+
+	if (pde == NULL)
+		return NULL;
+	if (*pde & PTE_PS) {
+		if (!create)
+			return pde;
+		if (!large_split (pml4e, pde, va))
+			return NULL;
 	}
-	return pte;
+	uint64_t *pt = next_table (pde, create, &unused);
+	return pt != NULL ? &pt[PTX (va)] : NULL;
 }
 
 /* Creates a new page map level 4 (pml4) has mappings for kernel
@@ -94,7 +223,7 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
  * allocation fails. */
 uint64_t *
 pml4_create (void) {
-	uint64_t *pml4 = palloc_get_page (0);
+	uint64_t *pml4 = pt_alloc ();
 	if (pml4)
 		memcpy (pml4, base_pml4, PGSIZE);
 	return pml4;
@@ -122,7 +251,14 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((((uint64_t) pte) & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS)) {
+			/* A superpage is passed once, as its PDE. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -143,7 +279,8 @@ pdp_for_each (uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * Superpages are passed as their page directory entries. */
 bool
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -162,17 +299,22 @@ pt_destroy (uint64_t *pt) {
 		if (((uint64_t) pte) & PTE_P)
 			palloc_free_page ((void *) PTE_ADDR (pte));
 	}
-	palloc_free_page ((void *) pt);
+	pt_free ((void *) pt);
 }
 
 static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((((uint64_t) pte) & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS)) {
+			uint64_t *spare = spare_take (&pdp[i]);
+			if (spare != NULL)
+				pt_free (spare);
+			palloc_free_multiple ((void *) PTE_ADDR (pte), LARGE_PGCNT);
+		} else if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
-	palloc_free_page ((void *) pdp);
+	pt_free ((void *) pdp);
 }
 
 static void
@@ -182,7 +324,7 @@ pdpe_destroy (uint64_t *pdpe) {
 		if (((uint64_t) pde) & PTE_P)
 			pgdir_destroy ((void *) PTE_ADDR (pde));
 	}
-	palloc_free_page ((void *) pdpe);
+	pt_free ((void *) pdpe);
 }
 
 /* Destroys pml4e, freeing all the pages it references. */
@@ -192,18 +334,133 @@ pml4_destroy (uint64_t *pml4) {
 		return;
 	ASSERT (pml4 != base_pml4);
 
+	ASSERT (!pml4_is_active (pml4));
+
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
-	palloc_free_page ((void *) pml4);
+	if (pcid_enabled && (pml4[PML4_META] >> META_PCID_SHIFT) != 0) {
+		enum intr_level old_level = intr_disable ();
+		bitmap_reset (pcid_map, pml4[PML4_META] >> META_PCID_SHIFT);
+		intr_set_level (old_level);
+	}
+	pt_free ((void *) pml4);
+}
+
+/* Turns on global pages and PCIDs if the CPU has them and -nopge
+ * and -nopcid were not given.  Must be called with base_pml4
+ * active. */
+void
+tlb_init (void) {
+	if (mmu_use_pge && (cpuid_edx (1) & CPUID_1_EDX_PGE)) {
+		lcr4 (rcr4 () | CR4_PGE);
+		pge_enabled = true;
+	}
+
+	if (!mmu_use_pcid || !(cpuid_ecx (1) & CPUID_1_ECX_PCID))
+		return;
+	ASSERT (rcr3 () == vtop (base_pml4));
+	ASSERT (!(base_pml4[PML4_META] & PTE_P));
+
+	pcid_map = bitmap_create_in_buf (PCID_CNT, pcid_map_buf,
+			sizeof pcid_map_buf);
+	bitmap_mark (pcid_map, 0);
+	pcid_gen[0] = tlb_gen;
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Flushes every TLB entry, global or not, of every PCID. */
+void
+tlb_flush_all (void) {
+	enum intr_level old_level = intr_disable ();
+
+	tlb_stats.full_flushes++;
+	if (pge_enabled) {
+		/* Any change to CR4.PGE flushes the whole TLB. */
+		uint64_t cr4 = rcr4 ();
+		lcr4 (cr4 & ~CR4_PGE);
+		lcr4 (cr4);
+	} else {
+		if (pcid_enabled) {
+			tlb_gen++;
+			pcid_gen[rcr3 () & 0xfff] = tlb_gen;
+		}
+		/* Bit 63 of CR3 reads as 0, so this flushes the current
+		 * PCID. */
+		lcr3 (rcr3 ());
+	}
+	intr_set_level (old_level);
+}
+
+/* Returns the PCID of PML4, assigning one if it has none yet. */
+static unsigned
+pcid_get (uint64_t *pml4) {
+	uint64_t meta = pml4[PML4_META];
+	size_t pcid = meta >> META_PCID_SHIFT;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (pcid != 0 || (meta & META_NO_PCID))
+		return pcid;
+
+	pcid = bitmap_scan_and_flip (pcid_map, 1, 1, false);
+	if (pcid == BITMAP_ERROR) {
+		pml4[PML4_META] = META_NO_PCID;
+		tlb_stats.overflows++;
+		return 0;
+	}
+	/* A recycled PCID may still tag its last owner's entries. */
+	pcid_gen[pcid] = 0;
+	pml4[PML4_META] = (uint64_t) pcid << META_PCID_SHIFT;
+	tlb_stats.assigned++;
+	return pcid;
+}
+
+/* Returns true if PML4 is the active page map. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+/* Invalidates any TLB entry for virtual page VA of PML4: at once
+ * if PML4 is active, otherwise by flushing its PCID, if it has
+ * one, when it is next activated.  Without PCIDs that happens on
+ * every activation anyway. */
+void
+pml4_invalidate (uint64_t *pml4, const void *va) {
+	if (pml4_is_active (pml4))
+		invlpg ((uint64_t) va);
+	else if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		pcid_gen[pml4[PML4_META] >> META_PCID_SHIFT] = 0;
+		intr_set_level (old_level);
+	}
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs, the TLB entries of PD's PCID are kept
+ * unless they may be stale. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	uint64_t cr3 = vtop (pml4 ? pml4 : base_pml4);
+
+	tlb_stats.loads++;
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		unsigned pcid = pml4 != NULL ? pcid_get (pml4) : 0;
+		bool flush = pcid_gen[pcid] != tlb_gen
+			|| (pml4 != NULL && pcid == 0);
+
+		pcid_gen[pcid] = tlb_gen;
+		if (flush)
+			tlb_stats.flushes++;
+		lcr3 (cr3 | pcid | (flush ? 0 : CR3_NOFLUSH));
+		intr_set_level (old_level);
+	} else {
+		tlb_stats.flushes++;
+		lcr3 (cr3);
+	}
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -216,8 +473,12 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
-	if (pte && (*pte & PTE_P))
+	if (pte && (*pte & PTE_P)) {
+		if (*pte & PTE_PS)
+			return ptov (PTE_ADDR (*pte))
+				+ ((uint64_t) uaddr & (LARGE_PGSIZE - 1));
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+	}
 	return NULL;
 }
 
@@ -238,14 +499,52 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		bool was_present = (*pte & PTE_P) != 0;
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (was_present)
+			pml4_invalidate (pml4, upage);
+	}
 	return pte != NULL;
 }
 
+/* Maps the 2 MB of user virtual memory starting at UPAGE in PML4
+ * to the physically contiguous frames starting at kernel virtual
+ * address KPAGE with a single page directory entry.  Both must be
+ * 2 MB aligned and no page in the range may be mapped.  If RW is
+ * true the pages are writable.  Returns true if successful, false
+ * if memory allocation failed or part of the range is mapped. */
+bool
+pml4_set_large_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	uint64_t *pde, *spare;
+	ASSERT ((uint64_t) upage % LARGE_PGSIZE == 0);
+	ASSERT (vtop (kpage) % LARGE_PGSIZE == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	pde = pde_walk (pml4, (uint64_t) upage, 1);
+	if (pde == NULL || (*pde & PTE_PS))
+		return false;
+	if (*pde & PTE_P) {
+		/* An empty page table left from earlier mappings, kept for
+		 * splitting the superpage. */
+		spare = ptov (PTE_ADDR (*pde));
+		for (unsigned i = 0; i < LARGE_PGCNT; i++)
+			if (spare[i] & PTE_P)
+				return false;
+	} else if ((spare = pt_alloc ()) == NULL)
+		return false;
+	spare_add (pde, spare);
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	pml4_invalidate (pml4, upage);
+	mmu_stats.user_large++;
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
- * bits in the page table entry are preserved.
+ * bits in the page table entry are preserved.  A superpage
+ * containing UPAGE is split, so that only UPAGE is affected.
  * UPAGE need not be mapped. */
 void
 pml4_clear_page (uint64_t *pml4, void *upage) {
@@ -254,14 +553,101 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	ASSERT (is_user_vaddr (upage));
 
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte != NULL && (*pte & PTE_PS)) {
+		/* User superpages keep a table for this, so the split
+		 * cannot run out of memory. */
+		pte = pml4e_walk (pml4, (uint64_t) upage, true);
+		ASSERT (pte != NULL);
+	}
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		pml4_invalidate (pml4, upage);
 	}
 }
 
+/* Maps kernel virtual page KVA, which must lie outside the direct
+ * map, to the physical frame of direct-mapped page KPAGE.  Page
+ * tables are created as needed under base_pml4; every pml4 shares
+ * its kernel half below the top level, so the mapping is visible
+ * in all address spaces.  If RW is true the page is writable.
+ * Returns true if successful, false if memory allocation failed. */
+bool
+kern_set_page (void *kva, void *kpage, bool rw) {
+	uint64_t *pte;
+	ASSERT (pg_ofs (kva) == 0);
+	ASSERT (pg_ofs (kpage) == 0);
+	ASSERT (is_kernel_vaddr (kva));
+	ASSERT (base_pml4[PML4 (kva)] & PTE_P);
+
+	pte = pml4e_walk (base_pml4, (uint64_t) kva, 1);
+	if (pte != NULL) {
+		ASSERT ((*pte & PTE_P) == 0);
+		*pte = vtop (kpage) | PTE_G | PTE_P | (rw ? PTE_W : 0);
+	}
+	return pte != NULL;
+}
+
+/* Maps the 2 MB of kernel virtual memory at KVA to physical
+ * address PA with a single page directory entry in base_pml4,
+ * creating the tables above it as needed.  Both must be 2 MB
+ * aligned and the range must not be mapped yet.  If RW is true
+ * the memory is writable.  Returns true if successful, false if
+ * memory allocation failed. */
+bool
+kern_set_large_page (void *kva, uint64_t pa, bool rw) {
+	uint64_t *pde;
+	ASSERT ((uint64_t) kva % LARGE_PGSIZE == 0);
+	ASSERT (pa % LARGE_PGSIZE == 0);
+	ASSERT (is_kernel_vaddr (kva));
+
+	pde = pde_walk (base_pml4, (uint64_t) kva, 1);
+	if (pde != NULL) {
+		ASSERT ((*pde & PTE_P) == 0);
+		*pde = pa | PTE_PS | PTE_G | PTE_P | (rw ? PTE_W : 0);
+		mmu_stats.kern_large++;
+	}
+	return pde != NULL;
+}
+
+/* Invalidates any TLB entry for kernel virtual page KVA.  A global
+ * entry is shared by every PCID and invlpg removes it; otherwise
+ * every PCID may hold one, so all but the current one are flushed
+ * on their next activation. */
+static void
+kern_invalidate (void *kva) {
+	enum intr_level old_level = intr_disable ();
+	invlpg ((uint64_t) kva);
+	if (pcid_enabled && !pge_enabled) {
+		tlb_gen++;
+		pcid_gen[rcr3 () & 0xfff] = tlb_gen;
+	}
+	intr_set_level (old_level);
+}
+
+/* Removes the mapping of kernel virtual page KVA installed by
+ * kern_set_page() and returns the direct-mapped address of the
+ * frame it pointed to, or a null pointer if KVA was not mapped.
+ * Page tables are left in place for later mappings.  Unless
+ * INVALIDATE is true, the caller must call tlb_flush_all() before
+ * the frame is reused. */
+void *
+kern_clear_page (void *kva, bool invalidate) {
+	uint64_t *pte;
+	void *kpage;
+	ASSERT (pg_ofs (kva) == 0);
+	ASSERT (is_kernel_vaddr (kva));
+
+	pte = pml4e_walk (base_pml4, (uint64_t) kva, false);
+	if (pte == NULL || (*pte & PTE_P) == 0)
+		return NULL;
+	kpage = ptov (PTE_ADDR (*pte));
+	*pte = 0;
+	if (invalidate)
+		kern_invalidate (kva);
+	return kpage;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
  * that is, if the page has been modified since the PTE was
  * installed.
@@ -283,8 +669,8 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		/* A cached entry would let writes go unrecorded. */
+		pml4_invalidate (pml4, vpage);
 	}
 }
 
@@ -309,7 +695,26 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
+		/* A cached entry only hides later accesses until it is
+		 * evicted, so an inactive PCID is not worth flushing. */
+		if (pml4_is_active (pml4))
 			invlpg ((uint64_t) vpage);
 	}
 }
+
+/* Prints page table statistics. */
+void
+mmu_print_stats (void) {
+	printf ("Page tables: %zu pages in use, %zu peak; kernel direct map "
+			"has %zu 2 MB pages\n", mmu_stats.pt_pages,
+			mmu_stats.peak_pt_pages, mmu_stats.kern_large);
+	if (mmu_stats.user_large > 0)
+		printf ("Page tables: %llu user 2 MB pages mapped, %llu split\n",
+				mmu_stats.user_large, mmu_stats.splits);
+	printf ("TLB: PCIDs %s, %llu CR3 loads, %llu flushed, %llu PCIDs "
+			"assigned, %llu pml4s without one\n",
+			pcid_enabled ? "on" : "off", tlb_stats.loads, tlb_stats.flushes,
+			tlb_stats.assigned, tlb_stats.overflows);
+	printf ("TLB: global pages %s, %llu full flushes\n",
+			pge_enabled ? "on" : "off", tlb_stats.full_flushes);
+}
@@ -284,6 +284,39 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Obtains PAGE_CNT contiguous free pages, like
+   palloc_get_multiple(), whose physical address is a multiple of
+   ALIGN_CNT pages.  Returns a null pointer if no such run is
+   free, unless PAL_ASSERT is set in FLAGS, in which case the
+   kernel panics. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt,
+		size_t align_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t pool_size = bitmap_size (pool->used_map);
+	size_t page_idx = (align_cnt - pg_no (vtop (pool->base)) % align_cnt)
+		% align_cnt;
+	void *pages = NULL;
+
+	lock_acquire (&pool->lock);
+	for (; page_idx + page_cnt <= pool_size; page_idx += align_cnt)
+		if (!bitmap_contains (pool->used_map, page_idx, page_cnt, true)) {
+			bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+			pages = pool->base + PGSIZE * page_idx;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			memset (pages, 0, PGSIZE * page_cnt);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get: out of pages");
+	}
+	return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -328,6 +361,20 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_pages (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the index of PAGE, which must be allocated from the user
+ * pool, within the pool. */
+size_t
+palloc_user_page_no (void *page) {
+	ASSERT (page_from_pool (&user_pool, page));
+	return pg_no (page) - pg_no (user_pool.base);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
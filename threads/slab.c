@@ -0,0 +1,330 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator for fixed-size kernel objects, after Bonwick.
+
+   Each object type that is allocated often (struct page, struct
+   frame, struct inode, ...) gets its own cache.  A cache owns a
+   set of slabs, each of which is a single page from the kernel
+   pool: a small header at the start of the page followed by an
+   array of equally sized objects.  Free objects in a slab are
+   chained through a pointer stored inside the object itself, so
+   allocation and release are a lock plus a list pop/push.
+
+   Slabs are kept on three lists by occupancy.  Allocation always
+   draws from a partially used slab first, so memory stays
+   packed; a slab that becomes entirely free is parked on the
+   empty list (up to SLAB_EMPTY_MAX of them) instead of going
+   straight back to the page allocator, which absorbs the common
+   alloc/free ping-pong of fault handling.
+
+   The bytes left over at the end of a page once the objects are
+   laid out are used to "color" slabs: successive slabs shift
+   their first object by one cache line, so that the same field
+   of objects in different slabs does not always land on the same
+   cache set.
+
+   If the cache has a constructor, objects are constructed once
+   when the slab is created, and the free-list pointer is kept in
+   an extra word after the object so that it does not clobber the
+   constructed state. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Object alignment and coloring granularity. */
+#define SLAB_ALIGN 8
+#define CACHE_LINE 64
+
+/* Number of completely free slabs a cache holds on to. */
+#define SLAB_EMPTY_MAX 1
+
+/* Object cache. */
+struct slab_cache {
+	char name[16];              /* Name, for statistics. */
+	size_t obj_size;            /* Requested object size. */
+	size_t stride;              /* Object size plus link, aligned. */
+	size_t link_ofs;            /* Offset of free-list link in object. */
+	size_t obj_cnt;             /* Objects per slab. */
+	size_t color_cnt;           /* Number of distinct colors. */
+	size_t next_color;          /* Color of the next new slab. */
+	slab_ctor_func *ctor;       /* Constructor, or null. */
+	struct lock lock;           /* Protects everything below. */
+	struct list partial;        /* Slabs with free and used objects. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list empty;          /* Slabs with no used objects. */
+	size_t empty_cnt;           /* Length of EMPTY. */
+	struct list_elem elem;      /* Element in all_caches. */
+
+	/* Statistics. */
+	size_t slab_cnt;            /* Slabs currently held. */
+	size_t in_use;              /* Objects currently allocated. */
+	size_t peak;                /* Maximum of IN_USE. */
+	unsigned long long alloc_cnt;
+	unsigned long long free_cnt;
+	unsigned long long grow_cnt;  /* Slabs taken from palloc. */
+	unsigned long long reap_cnt;  /* Slabs returned to palloc. */
+};
+
+/* Slab header, at the start of each slab page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct slab_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of the cache lists. */
+	size_t in_use;              /* Allocated objects in this slab. */
+	void *free;                 /* First free object, or null. */
+};
+
+#define SLAB_HDR_SIZE ROUND_UP (sizeof (struct slab), SLAB_ALIGN)
+
+/* Cache of cache descriptors, and the list of all caches. */
+static struct slab_cache cache_cache;
+static struct list all_caches;
+static struct lock all_caches_lock;
+
+static void cache_init (struct slab_cache *, const char *name,
+                        size_t obj_size, slab_ctor_func *);
+static struct slab *slab_grow (struct slab_cache *);
+static size_t malloc_equiv (size_t size);
+
+static inline void **
+obj_link (struct slab_cache *c, void *obj) {
+	return (void **) ((uint8_t *) obj + c->link_ofs);
+}
+
+/* Initializes the slab allocator.  Must be called after
+   palloc_init() and before any cache is created. */
+void
+slab_init (void) {
+	list_init (&all_caches);
+	lock_init (&all_caches_lock);
+	cache_init (&cache_cache, "slab_cache", sizeof (struct slab_cache), NULL);
+}
+
+/* Creates a cache of objects of OBJ_SIZE bytes named NAME.  If
+   CTOR is nonnull it is run on every object once, when the slab
+   containing it is created.  Returns a null pointer if memory
+   is exhausted. */
+struct slab_cache *
+slab_cache_create (const char *name, size_t obj_size, slab_ctor_func *ctor) {
+	struct slab_cache *c;
+
+	ASSERT (obj_size > 0);
+	ASSERT (obj_size + sizeof (void *) <= (PGSIZE - SLAB_HDR_SIZE) / 2);
+
+	c = slab_alloc (&cache_cache);
+	if (c != NULL)
+		cache_init (c, name, obj_size, ctor);
+	return c;
+}
+
+/* Returns a free object from cache C, or a null pointer if no
+   memory is available. */
+void *
+slab_alloc (struct slab_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	lock_acquire (&c->lock);
+	if (list_empty (&c->partial)) {
+		if (!list_empty (&c->empty)) {
+			s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+			c->empty_cnt--;
+		} else {
+			s = slab_grow (c);
+			if (s == NULL) {
+				lock_release (&c->lock);
+				return NULL;
+			}
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	s = list_entry (list_front (&c->partial), struct slab, elem);
+	ASSERT (s->free != NULL);
+	obj = s->free;
+	s->free = *obj_link (c, obj);
+	if (++s->in_use == c->obj_cnt) {
+		list_remove (&s->elem);
+		list_push_back (&c->full, &s->elem);
+	}
+
+	c->alloc_cnt++;
+	if (++c->in_use > c->peak)
+		c->peak = c->in_use;
+	lock_release (&c->lock);
+
+	return obj;
+}
+
+/* Returns OBJ, previously obtained from slab_alloc() on cache C,
+   to C.  A null OBJ is ignored. */
+void
+slab_free (struct slab_cache *c, void *obj) {
+	struct slab *s;
+
+	if (obj == NULL)
+		return;
+
+	s = pg_round_down (obj);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT (s->in_use > 0);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs.  With a
+	   constructor the object must stay constructed. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	*obj_link (c, obj) = s->free;
+	s->free = obj;
+
+	if (s->in_use-- == c->obj_cnt) {
+		/* Was full, now partial. */
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	if (s->in_use == 0) {
+		list_remove (&s->elem);
+		if (c->empty_cnt < SLAB_EMPTY_MAX) {
+			list_push_front (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else {
+			s->magic = 0;
+			c->slab_cnt--;
+			c->reap_cnt++;
+			palloc_free_page (s);
+		}
+	}
+
+	c->free_cnt++;
+	c->in_use--;
+	lock_release (&c->lock);
+}
+
+/* Prints statistics for every cache, including how many bytes
+   the same objects would occupy if they came from malloc(). */
+void
+slab_print_stats (void) {
+	struct list_elem *e;
+
+	printf ("Slab: %-12s %5s %4s %5s %6s %6s %8s %8s %8s\n",
+	        "cache", "size", "/pg", "slabs", "inuse", "peak",
+	        "allocs", "bytes", "malloc");
+	lock_acquire (&all_caches_lock);
+	for (e = list_begin (&all_caches); e != list_end (&all_caches);
+	     e = list_next (e)) {
+		struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+		printf ("Slab: %-12s %5zu %4zu %5zu %6zu %6zu %8llu %8zu %8zu\n",
+		        c->name, c->obj_size, c->obj_cnt, c->slab_cnt, c->in_use,
+		        c->peak, c->alloc_cnt, c->slab_cnt * PGSIZE,
+		        c->in_use * malloc_equiv (c->obj_size));
+	}
+	lock_release (&all_caches_lock);
+}
+
+/* Initializes C as a cache of OBJ_SIZE-byte objects and adds it
+   to the list of all caches. */
+static void
+cache_init (struct slab_cache *c, const char *name, size_t obj_size,
+            slab_ctor_func *ctor) {
+	size_t avail, leftover;
+
+	strlcpy (c->name, name, sizeof c->name);
+	c->obj_size = obj_size;
+	c->ctor = ctor;
+	if (ctor == NULL) {
+		c->link_ofs = 0;
+		c->stride = ROUND_UP (obj_size < sizeof (void *)
+		                      ? sizeof (void *) : obj_size, SLAB_ALIGN);
+	} else {
+		c->link_ofs = ROUND_UP (obj_size, sizeof (void *));
+		c->stride = ROUND_UP (c->link_ofs + sizeof (void *), SLAB_ALIGN);
+	}
+
+	avail = PGSIZE - SLAB_HDR_SIZE;
+	c->obj_cnt = avail / c->stride;
+	leftover = avail - c->obj_cnt * c->stride;
+	c->color_cnt = leftover / CACHE_LINE + 1;
+	c->next_color = 0;
+
+	lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+
+	c->slab_cnt = c->in_use = c->peak = 0;
+	c->alloc_cnt = c->free_cnt = c->grow_cnt = c->reap_cnt = 0;
+
+	lock_acquire (&all_caches_lock);
+	list_push_back (&all_caches, &c->elem);
+	lock_release (&all_caches_lock);
+}
+
+/* Obtains a new slab for C from the page allocator, constructs
+   its objects and threads them onto the slab's free list.
+   Returns the slab, or a null pointer on failure.  C's lock must
+   be held. */
+static struct slab *
+slab_grow (struct slab_cache *c) {
+	struct slab *s;
+	uint8_t *first;
+	void **prev;
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&c->lock));
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->in_use = 0;
+
+	first = (uint8_t *) s + SLAB_HDR_SIZE + c->next_color * CACHE_LINE;
+	c->next_color = (c->next_color + 1) % c->color_cnt;
+
+	prev = &s->free;
+	for (i = 0; i < c->obj_cnt; i++) {
+		void *obj = first + i * c->stride;
+		if (c->ctor != NULL)
+			c->ctor (obj);
+		*prev = obj;
+		prev = obj_link (c, obj);
+	}
+	*prev = NULL;
+
+	c->slab_cnt++;
+	c->grow_cnt++;
+	return s;
+}
+
+/* Returns the number of bytes malloc() would set aside for a
+   SIZE-byte request, ignoring the arena header.  This mirrors
+   malloc()'s size classes: multiples of 8 below 64 bytes, then
+   eight classes per power of two, then whole pages. */
+static size_t
+malloc_equiv (size_t size) {
+	size_t step;
+
+	if (size > (PGSIZE - 24) / 2)
+		return DIV_ROUND_UP (size + 24, PGSIZE) * PGSIZE;
+	for (step = 8; size > step * 16; step *= 2)
+		continue;
+	return ROUND_UP (size < 16 ? 16 : size, step);
+}
@@ -7,6 +7,7 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -269,12 +270,6 @@ thread_create (const char *name, int priority,
 	struct thread *cur = thread_current();
 	list_push_back(&cur->child_list, &t->chlid_elem);
 
-	t->fd_table = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-	if(t->fd_table == NULL)return TID_ERROR;
-	t->fd_idx = 2;
-	t->fd_table[0] = 1;
-	t->fd_table[1] = 2;
-
 
 
 
@@ -452,6 +447,7 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
+	malloc_thread_exit ();
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
@@ -460,6 +456,21 @@ thread_exit (void) {
 	NOT_REACHED ();
 }
 
+/* Invoke function 'func' on all threads, passing along 'aux'.
+   This function must be called with interrupts off. */
+void
+thread_foreach (thread_action_func *func, void *aux) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+		func (t, aux);
+	}
+}
+
 /* Yields the CPU.  The current thread is not put to sleep and
    may be scheduled again immediately at the scheduler's whim. */
 void
@@ -483,7 +494,7 @@ thread_yield (void) {
 //강제 토스
 //스레드에 선점 여부 테스트
 void
-thread_preemption(){
+thread_preemption(void){
 	if(!intr_context() && !list_empty(&ready_list)&&
 	thread_get_priority() 
 	<list_entry(list_front(&ready_list), struct thread, elem)->priority
@@ -0,0 +1,134 @@
+#include "threads/vmalloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <string.h>
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Virtually contiguous kernel allocations.
+
+   palloc_get_multiple() needs physically contiguous pages, which
+   become hard to find once the kernel pool is fragmented even if
+   plenty of single pages are free.  vmalloc() instead takes
+   PAGE_CNT individual pages from the kernel pool and maps them
+   side by side into a range of kernel virtual addresses set
+   aside for this purpose, between VMALLOC_START and VMALLOC_END.
+
+   Address space in the range is handed out from a bitmap, with
+   one unmapped guard page after every allocation so that running
+   off the end of a buffer faults instead of corrupting its
+   neighbor.  The mappings live in base_pml4's page tables, which
+   every process shares, so a vmalloc() block can be used from any
+   thread.  Page tables created for the range are kept for reuse
+   when blocks are freed. */
+
+/* Blocks larger than this many pages are unmapped with a single
+   flush of the whole TLB rather than one invlpg per page. */
+#define VFREE_FLUSH_PAGES 32
+
+/* One bit per page of the vmalloc range. */
+static struct bitmap *used_map;
+static uint8_t used_map_buf[DIV_ROUND_UP (VMALLOC_PAGES, 8) + 64];
+
+/* Serializes allocation and page-table updates in the range. */
+static struct lock vmalloc_lock;
+
+/* Initializes the vmalloc range.  Must be called after paging
+   has been set up. */
+void
+vmalloc_init (void) {
+	ASSERT (bitmap_buf_size (VMALLOC_PAGES) <= sizeof used_map_buf);
+	used_map = bitmap_create_in_buf (VMALLOC_PAGES, used_map_buf,
+	                                 sizeof used_map_buf);
+	lock_init (&vmalloc_lock);
+}
+
+/* Obtains PAGE_CNT pages from the kernel pool, not necessarily
+   contiguous, and maps them at consecutive kernel virtual
+   addresses.  If PAL_ZERO is set in FLAGS, the pages are zeroed.
+   If too few pages or too little address space is available,
+   returns a null pointer, unless PAL_ASSERT is set in FLAGS, in
+   which case the kernel panics. */
+void *
+vmalloc (enum palloc_flags flags, size_t page_cnt) {
+	uint8_t *va;
+	size_t idx, i;
+
+	ASSERT ((flags & PAL_USER) == 0);
+	if (page_cnt == 0)
+		return NULL;
+
+	lock_acquire (&vmalloc_lock);
+	idx = bitmap_scan_and_flip (used_map, 0, page_cnt + 1, false);
+	if (idx == BITMAP_ERROR)
+		goto fail;
+
+	va = (uint8_t *) VMALLOC_START + idx * PGSIZE;
+	for (i = 0; i < page_cnt; i++) {
+		void *kpage = palloc_get_page (flags & PAL_ZERO);
+		if (kpage == NULL)
+			goto unmap;
+		if (!kern_set_page (va + i * PGSIZE, kpage, true)) {
+			palloc_free_page (kpage);
+			goto unmap;
+		}
+	}
+	lock_release (&vmalloc_lock);
+	return va;
+
+unmap:
+	while (i-- > 0)
+		palloc_free_page (kern_clear_page (va + i * PGSIZE, true));
+	bitmap_set_multiple (used_map, idx, page_cnt + 1, false);
+fail:
+	lock_release (&vmalloc_lock);
+	if (flags & PAL_ASSERT)
+		PANIC ("vmalloc: out of pages");
+	return NULL;
+}
+
+/* Unmaps and frees the PAGE_CNT pages starting at VA, which must
+   have been obtained with vmalloc(). */
+void
+vfree (void *va_, size_t page_cnt) {
+	uint8_t *va = va_;
+	bool batch = page_cnt > VFREE_FLUSH_PAGES;
+	void *batched = NULL;
+	size_t idx, i;
+
+	if (va == NULL)
+		return;
+	ASSERT (pg_ofs (va) == 0);
+	ASSERT (is_vmalloc_vaddr (va));
+
+	idx = pg_no (va) - pg_no (VMALLOC_START);
+	lock_acquire (&vmalloc_lock);
+	ASSERT (bitmap_all (used_map, idx, page_cnt + 1));
+	for (i = 0; i < page_cnt; i++) {
+		void *kpage = kern_clear_page (va + i * PGSIZE, !batch);
+		ASSERT (kpage != NULL);
+#ifndef NDEBUG
+		memset (kpage, 0xcc, PGSIZE);
+#endif
+		if (batch) {
+			/* Stale entries may still reach the page until the
+			   flush, so chain it through its first word and free
+			   it afterward. */
+			*(void **) kpage = batched;
+			batched = kpage;
+		} else
+			palloc_free_page (kpage);
+	}
+	if (batch) {
+		tlb_flush_all ();
+		while (batched != NULL) {
+			void *next = *(void **) batched;
+			palloc_free_page (batched);
+			batched = next;
+		}
+	}
+	bitmap_set_multiple (used_map, idx, page_cnt + 1, false);
+	lock_release (&vmalloc_lock);
+}
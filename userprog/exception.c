@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "intrinsic.h"
@@ -146,6 +147,10 @@ page_fault (struct intr_frame *f) {
 	// 	thread_current()->user_rsp = f->rsp;
 	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
 		return;
+#else
+	/* Write to a page shared with a parent or child since fork. */
+	if (!not_present && write && process_handle_cow (fault_addr))
+		return;
 #endif
 
 	/* Count page faults. */
@@ -0,0 +1,195 @@
+/* exec_cache.c: Cache of parsed executable headers.
+ *
+ * load() reads and validates an executable's ELF header and program
+ * headers on every exec.  The cache keeps the result, an exec_image,
+ * for the few executables run most recently, keyed by inode sector,
+ * so that running the same program again goes straight to mapping
+ * its segments.
+ *
+ * Each cached image holds its inode open, so the sector cannot be
+ * reused for another file behind the cache's back, and remembers
+ * the inode's generation, which every write to the file and its
+ * removal advance.  An image whose generation is out of date is
+ * dropped when it is next looked up.  Removing the file drops its
+ * image at once, so that the cache does not keep a removed file's
+ * blocks from being freed. */
+
+#include "userprog/exec_cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Most images kept. */
+#define EXEC_CACHE_SIZE 8
+
+bool exec_cache_enabled = true;
+
+static struct list exec_cache;      /* Most recently used first. */
+static size_t exec_cache_cnt;       /* Images in EXEC_CACHE. */
+static struct lock exec_cache_lock; /* Protects the above and ref_cnt. */
+
+/* Exec cache statistics. */
+static struct {
+	unsigned long long hits;        /* Lookups that found an image. */
+	unsigned long long misses;      /* Lookups that did not. */
+	unsigned long long stale;       /* Images dropped as out of date. */
+} exec_cache_stats;
+
+/* Initializes the exec cache. */
+void
+exec_cache_init (void) {
+	list_init (&exec_cache);
+	lock_init (&exec_cache_lock);
+}
+
+/* Returns a new image with room for SEG_MAX segments and no
+ * segments yet, or a null pointer if out of memory.  The caller owns
+ * the only reference. */
+struct exec_image *
+exec_image_create (size_t seg_max) {
+	struct exec_image *image;
+
+	image = malloc (sizeof *image + seg_max * sizeof *image->segs);
+	if (image == NULL)
+		return NULL;
+	image->entry = 0;
+	image->seg_cnt = 0;
+	image->segs = (struct exec_segment *) (image + 1);
+	image->inode = NULL;
+	image->ref_cnt = 1;
+	return image;
+}
+
+/* Returns the cached image of the executable INODE, with a reference
+ * for the caller, or a null pointer if there is none. */
+struct exec_image *
+exec_cache_lookup (struct inode *inode) {
+	disk_sector_t sector = inode_get_inumber (inode);
+	struct exec_image *image = NULL, *stale = NULL;
+	struct list_elem *e;
+
+	if (!exec_cache_enabled)
+		return NULL;
+
+	lock_acquire (&exec_cache_lock);
+	for (e = list_begin (&exec_cache); e != list_end (&exec_cache);
+			e = list_next (e)) {
+		struct exec_image *i = list_entry (e, struct exec_image, elem);
+
+		if (i->sector != sector)
+			continue;
+		list_remove (e);
+		if (i->generation == inode_get_generation (inode)) {
+			list_push_front (&exec_cache, e);
+			i->ref_cnt++;
+			image = i;
+		} else {
+			exec_cache_cnt--;
+			exec_cache_stats.stale++;
+			stale = i;
+		}
+		break;
+	}
+	if (image != NULL)
+		exec_cache_stats.hits++;
+	else
+		exec_cache_stats.misses++;
+	lock_release (&exec_cache_lock);
+
+	if (stale != NULL)
+		exec_cache_release (stale);
+	return image;
+}
+
+/* Adds IMAGE, just parsed from the executable INODE, to the cache,
+ * which takes a reference of its own.  The least recently used image
+ * makes room for it if the cache is full. */
+void
+exec_cache_insert (struct inode *inode, struct exec_image *image) {
+	struct exec_image *victim = NULL;
+	struct list_elem *e;
+
+	ASSERT (image->inode == NULL);
+	if (!exec_cache_enabled)
+		return;
+
+	lock_acquire (&exec_cache_lock);
+	/* Another exec of the same program may have got here first. */
+	for (e = list_begin (&exec_cache); e != list_end (&exec_cache);
+			e = list_next (e))
+		if (list_entry (e, struct exec_image, elem)->sector
+				== inode_get_inumber (inode)) {
+			lock_release (&exec_cache_lock);
+			return;
+		}
+
+	image->inode = inode_reopen (inode);
+	image->sector = inode_get_inumber (inode);
+	image->generation = inode_get_generation (inode);
+	image->ref_cnt++;
+	list_push_front (&exec_cache, &image->elem);
+	if (++exec_cache_cnt > EXEC_CACHE_SIZE) {
+		victim = list_entry (list_pop_back (&exec_cache),
+				struct exec_image, elem);
+		exec_cache_cnt--;
+	}
+	lock_release (&exec_cache_lock);
+
+	if (victim != NULL)
+		exec_cache_release (victim);
+}
+
+/* Drops the cached image of INODE, if any, which is being removed.
+ * Processes still running it keep their references. */
+void
+exec_cache_invalidate (struct inode *inode) {
+	disk_sector_t sector = inode_get_inumber (inode);
+	struct exec_image *stale = NULL;
+	struct list_elem *e;
+
+	lock_acquire (&exec_cache_lock);
+	for (e = list_begin (&exec_cache); e != list_end (&exec_cache);
+			e = list_next (e)) {
+		struct exec_image *i = list_entry (e, struct exec_image, elem);
+
+		if (i->sector == sector) {
+			list_remove (e);
+			exec_cache_cnt--;
+			exec_cache_stats.stale++;
+			stale = i;
+			break;
+		}
+	}
+	lock_release (&exec_cache_lock);
+
+	if (stale != NULL)
+		exec_cache_release (stale);
+}
+
+/* Drops a reference to IMAGE, freeing it with the last one. */
+void
+exec_cache_release (struct exec_image *image) {
+	bool last;
+
+	if (image == NULL)
+		return;
+	lock_acquire (&exec_cache_lock);
+	last = --image->ref_cnt == 0;
+	lock_release (&exec_cache_lock);
+
+	if (last) {
+		inode_close (image->inode);
+		free (image);
+	}
+}
+
+/* Prints exec cache statistics. */
+void
+exec_cache_print_stats (void) {
+	if (exec_cache_stats.hits + exec_cache_stats.misses > 0)
+		printf ("Exec cache: %llu hits, %llu misses, %llu stale\n",
+				exec_cache_stats.hits, exec_cache_stats.misses,
+				exec_cache_stats.stale);
+}
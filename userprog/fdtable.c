@@ -0,0 +1,247 @@
+/* fdtable.c: Per-process file descriptor tables.
+ *
+ * A table is grown on demand, so a process with a handful of open
+ * files spends a few hundred bytes on it and a kernel thread spends
+ * nothing.  Allocation returns the lowest free descriptor, as POSIX
+ * requires: a bitmap of the descriptors in use is scanned a word at
+ * a time, starting from a hint below which every word is known to be
+ * full, so each allocation costs amortized constant time. */
+
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+
+/* Bits per word of the in-use bitmap. */
+#define FD_WORD_BITS (sizeof (unsigned long) * 8)
+
+/* Descriptors a table starts with room for. */
+#define FD_INIT 64
+
+/* Descriptor table statistics. */
+static struct {
+	size_t tables;                  /* Tables with memory allocated. */
+	size_t bytes;                   /* Bytes allocated to tables. */
+	size_t peak;                    /* Maximum of BYTES. */
+	unsigned long long allocs;      /* Lowest-free allocations. */
+	unsigned long long scanned;     /* Bitmap words they examined. */
+	unsigned long long grows;       /* Tables grown. */
+	unsigned long long copies;      /* Tables copied. */
+	unsigned long long copied;      /* Descriptors in them. */
+} fdt_stats;
+
+/* Bytes a table with room for CAP descriptors takes. */
+static size_t
+table_bytes (size_t cap) {
+	return cap * sizeof (struct file *) + cap / FD_WORD_BITS
+		* sizeof (unsigned long);
+}
+
+/* Grows T to have room for descriptor FD.  Returns false if FD is
+ * beyond FD_MAX or out of memory. */
+static bool
+grow (struct fd_table *t, size_t fd) {
+	size_t cap = t->cap > 0 ? t->cap : FD_INIT;
+	struct file **files;
+	unsigned long *used;
+
+	if (fd >= FD_MAX)
+		return false;
+	while (cap <= fd)
+		cap *= 2;
+	if (cap > FD_MAX)
+		cap = FD_MAX;
+
+	files = realloc (t->files, cap * sizeof *files);
+	if (files == NULL)
+		return false;
+	t->files = files;
+	used = realloc (t->used, cap / FD_WORD_BITS * sizeof *used);
+	if (used == NULL)
+		return false;
+	t->used = used;
+	memset (files + t->cap, 0, (cap - t->cap) * sizeof *files);
+	memset (used + t->cap / FD_WORD_BITS, 0,
+			(cap - t->cap) / FD_WORD_BITS * sizeof *used);
+
+	if (t->cap == 0)
+		fdt_stats.tables++;
+	else
+		fdt_stats.grows++;
+	fdt_stats.bytes += table_bytes (cap) - table_bytes (t->cap);
+	if (fdt_stats.bytes > fdt_stats.peak)
+		fdt_stats.peak = fdt_stats.bytes;
+	t->cap = cap;
+	return true;
+}
+
+/* Puts FILE, which is not null, in free slot FD of T. */
+static void
+set (struct fd_table *t, size_t fd, struct file *file) {
+	ASSERT (file != NULL);
+	ASSERT (t->files[fd] == NULL);
+	t->files[fd] = file;
+	t->used[fd / FD_WORD_BITS] |= 1UL << (fd % FD_WORD_BITS);
+	if (fd >= t->high)
+		t->high = fd + 1;
+}
+
+/* Moves T's free hint past the words that are full and returns it. */
+static size_t
+skip_full (struct fd_table *t) {
+	size_t words = t->cap / FD_WORD_BITS;
+
+	while (t->free_hint < words && t->used[t->free_hint] == ~0UL) {
+		t->free_hint++;
+		fdt_stats.scanned++;
+	}
+	return t->free_hint;
+}
+
+/* Installs the console as descriptors 0 and 1 of T, which is empty,
+ * as a new process's first table.  Returns false if out of
+ * memory. */
+bool
+fdt_init_console (struct fd_table *t) {
+	ASSERT (t->high == 0);
+	return fdt_install (t, 0, FD_STDIN) && fdt_install (t, 1, FD_STDOUT);
+}
+
+/* Puts FILE in the lowest free descriptor of T and returns it, or
+ * -1 if all FD_MAX descriptors are in use or out of memory. */
+int
+fdt_alloc (struct fd_table *t, struct file *file) {
+	size_t w = skip_full (t), fd;
+
+	fdt_stats.allocs++;
+	fdt_stats.scanned++;
+	if (w == t->cap / FD_WORD_BITS && !grow (t, t->cap))
+		return -1;
+	fd = w * FD_WORD_BITS + __builtin_ctzl (~t->used[w]);
+	set (t, fd, file);
+	return fd;
+}
+
+/* Puts FILE in descriptor FD of T, which must be free.  Returns
+ * false if FD is out of range or out of memory. */
+bool
+fdt_install (struct fd_table *t, int fd, struct file *file) {
+	if (fd < 0 || ((size_t) fd >= t->cap && !grow (t, fd)))
+		return false;
+	set (t, fd, file);
+	return true;
+}
+
+/* Returns the entry of descriptor FD in T, or a null pointer if FD
+ * is not in use. */
+struct file *
+fdt_get (const struct fd_table *t, int fd) {
+	if (fd < 0 || (size_t) fd >= t->cap)
+		return NULL;
+	return t->files[fd];
+}
+
+/* Frees descriptor FD of T and returns what it held, or a null
+ * pointer if it was not in use. */
+struct file *
+fdt_remove (struct fd_table *t, int fd) {
+	struct file *file = fdt_get (t, fd);
+	size_t w;
+
+	if (file == NULL)
+		return NULL;
+	w = fd / FD_WORD_BITS;
+	t->files[fd] = NULL;
+	t->used[w] &= ~(1UL << (fd % FD_WORD_BITS));
+	if (w < t->free_hint)
+		t->free_hint = w;
+	while (t->high > 0 && t->files[t->high - 1] == NULL)
+		t->high--;
+	return file;
+}
+
+/* Returns the lowest descriptor in use in T that is FD or above, or
+ * -1 if there is none.  Only the words of the bitmap below T's high
+ * water mark are examined. */
+int
+fdt_next (const struct fd_table *t, int fd) {
+	size_t w;
+	unsigned long bits;
+
+	if (fd < 0)
+		fd = 0;
+	if ((size_t) fd >= t->high)
+		return -1;
+	w = fd / FD_WORD_BITS;
+	bits = t->used[w] & (~0UL << (fd % FD_WORD_BITS));
+	while (bits == 0) {
+		if (++w * FD_WORD_BITS >= t->high)
+			return -1;
+		bits = t->used[w];
+	}
+	return w * FD_WORD_BITS + __builtin_ctzl (bits);
+}
+
+/* Makes DST, which is empty, hold the same entries as SRC, sized for
+ * SRC's high water mark rather than its capacity.  The caller takes
+ * care of the files' holders.  Returns false if out of memory. */
+bool
+fdt_copy (struct fd_table *dst, const struct fd_table *src) {
+	size_t words = DIV_ROUND_UP (src->high, FD_WORD_BITS), w;
+
+	ASSERT (dst->cap == 0);
+	if (src->high == 0)
+		return true;
+	if (!grow (dst, src->high - 1))
+		return false;
+	memcpy (dst->files, src->files, src->high * sizeof *dst->files);
+	memcpy (dst->used, src->used, words * sizeof *dst->used);
+	dst->high = src->high;
+	dst->free_hint = src->free_hint < words ? src->free_hint : words;
+
+	fdt_stats.copies++;
+	for (w = 0; w < words; w++) {
+		unsigned long bits;
+
+		for (bits = dst->used[w]; bits != 0; bits &= bits - 1)
+			fdt_stats.copied++;
+	}
+	return true;
+}
+
+/* Returns true if every descriptor T may have is in use. */
+bool
+fdt_full (struct fd_table *t) {
+	return t->cap == FD_MAX && skip_full (t) == FD_MAX / FD_WORD_BITS;
+}
+
+/* Frees T's memory, leaving it empty.  Its files must have been
+ * closed. */
+void
+fdt_destroy (struct fd_table *t) {
+	if (t->cap > 0) {
+		fdt_stats.tables--;
+		fdt_stats.bytes -= table_bytes (t->cap);
+	}
+	free (t->files);
+	free (t->used);
+	memset (t, 0, sizeof *t);
+}
+
+/* Prints descriptor table statistics. */
+void
+fdt_print_stats (void) {
+	if (fdt_stats.peak == 0)
+		return;
+	printf ("FD: %zu bytes in %zu tables, %zu peak, %llu tables grown\n",
+			fdt_stats.bytes, fdt_stats.tables, fdt_stats.peak,
+			fdt_stats.grows);
+	printf ("FD: %llu descriptors allocated, %llu bitmap words examined\n",
+			fdt_stats.allocs, fdt_stats.scanned);
+	if (fdt_stats.copies > 0)
+		printf ("FD: %llu tables copied, %llu descriptors shared\n",
+				fdt_stats.copies, fdt_stats.copied);
+}
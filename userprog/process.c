@@ -5,14 +5,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <syscall-nr.h>
 #include "userprog/gdt.h"
 #include "userprog/tss.h"
+#include "userprog/syscall.h"
+#include "userprog/exec_cache.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -24,6 +29,7 @@
 
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
+static bool process_load (char *f_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
 
@@ -73,6 +79,8 @@ initd (void *f_name) {
 
 	process_init ();
 
+	if (!fdt_init_console (&thread_current ()->fds))
+		PANIC("Fail to launch initd\n");
 	if (process_exec (f_name) < 0)
 		PANIC("Fail to launch initd\n");
 	NOT_REACHED ();
@@ -98,7 +106,41 @@ process_fork (const char *name, struct intr_frame *if_ UNUSED) {
 	return pid;
 }
 
+/* Exec statistics. */
+static struct {
+	unsigned long long loads;       /* Executables loaded. */
+	int64_t load_ticks;             /* Timer ticks spent loading them. */
+	int64_t load_max;               /* Longest of them. */
+	unsigned long long text_pages;  /* Read-only pages backed by the file. */
+	unsigned long long spawns;      /* Processes started by spawn(). */
+} exec_stats;
+
 #ifndef VM
+/* Without VM, fork shares every user page of the parent with the
+ * child instead of copying it.  A shared page is mapped with
+ * PTE_SHARED in each process, and read-only; if it was writable it
+ * also carries PTE_COW, and the first write to it takes a private
+ * copy (process_handle_cow()).  Since the child usually calls exec
+ * right away, most shared pages are never copied at all.
+ *
+ * COW_REFS counts the page tables mapping each shared page of the
+ * user pool.  It is only touched with interrupts off. */
+static uint16_t *cow_refs;
+
+/* Fork statistics. */
+static struct {
+	unsigned long long forks;       /* Address spaces duplicated. */
+	unsigned long long shared;      /* Pages shared at fork. */
+	unsigned long long copied;      /* Shared pages copied on write. */
+	unsigned long long reused;      /* Last sharers made writable. */
+} fork_stats;
+
+/* Returns the share count of the user page at KVA. */
+static uint16_t *
+cow_ref (void *kva) {
+	return &cow_refs[palloc_user_page_no (kva)];
+}
+
 /* Duplicate the parent's address space by passing this function to the
  * pml4_for_each. This is only for the project 2. */
 static bool
@@ -106,8 +148,9 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	struct thread *current = thread_current ();
 	struct thread *parent = (struct thread *) aux;
 	void *parent_page;
-	void *newpage;
+	uint64_t *child_pte;
 	bool writable;
+	enum intr_level old_level;
 
 	//system call
 	/* 1. TODO: If the parent_page is kernel page, then return immediately. */
@@ -118,26 +161,160 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	if(parent_page == NULL)
 		return false;
 
-	/* 3. TODO: Allocate new PAL_USER page for the child and set result to
-	 *    TODO: NEWPAGE. */
-	newpage = palloc_get_page(PAL_USER);
-	if(newpage == NULL)	return false;
-	/* 4. TODO: Duplicate parent's page to the new page and
-	 *    TODO: check whether parent's page is writable or not (set WRITABLE
-	 *    TODO: according to the result). */
-	memcpy(newpage, parent_page, PGSIZE);
-	writable = is_writable(pte);
-
-	/* 5. Add new page to child's page table at address VA with WRITABLE
-	 *    permission. */
-	if (!pml4_set_page (current->pml4, va, newpage, writable)) {
-		/* 6. TODO: if fail to insert page, do error handling. */
+	/* 3. Share the parent's page rather than copying it: both map it
+	 *    read-only, and a writable page is marked copy-on-write. */
+	writable = is_writable(pte) || (*pte & PTE_COW) != 0;
+	if (!pml4_set_page (current->pml4, va, parent_page, false))
+		return false;
+	child_pte = pml4e_walk (current->pml4, (uint64_t) va, 0);
+
+	old_level = intr_disable ();
+	if (*cow_ref (parent_page) == 0)
+		*cow_ref (parent_page) = 1;
+	ASSERT (*cow_ref (parent_page) < UINT16_MAX);
+	++*cow_ref (parent_page);
+	*pte = (*pte & ~PTE_W) | PTE_SHARED | (writable ? PTE_COW : 0);
+	*child_pte |= PTE_SHARED | (writable ? PTE_COW : 0);
+	intr_set_level (old_level);
+	pml4_invalidate (parent->pml4, va);
+
+	fork_stats.shared++;
+	return true;
+}
+
+/* Makes the copy-on-write page KVA, mapped at UPAGE of PML4 by PTE,
+ * private and writable, now that no one else shares it.  Interrupts
+ * must be off. */
+static void
+reuse_cow_page (uint64_t *pml4, void *upage, uint64_t *pte, void *kva) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	*cow_ref (kva) = 0;
+	*pte = (*pte | PTE_W) & ~(PTE_SHARED | PTE_COW);
+	pml4_invalidate (pml4, upage);
+	fork_stats.reused++;
+}
+
+/* Handles a write to the present, read-only page at ADDR of the
+ * current process.  If it is shared copy-on-write, gives the
+ * process a private copy of it, or, if no one else shares it any
+ * more, just makes it writable, and returns true.  Returns false if
+ * the write is not allowed or no memory is left for the copy. */
+bool
+process_handle_cow (void *addr) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	void *upage = pg_round_down (addr);
+	uint64_t *pte;
+	void *kva, *copy;
+	enum intr_level old_level;
+
+	if (pml4 == NULL || !is_user_vaddr (addr))
+		return false;
+	pte = pml4e_walk (pml4, (uint64_t) upage, 0);
+	if (pte == NULL || (*pte & (PTE_P | PTE_COW)) != (PTE_P | PTE_COW))
+		return false;
+	kva = ptov (PTE_ADDR (*pte));
+
+	old_level = intr_disable ();
+	if (*cow_ref (kva) <= 1) {
+		reuse_cow_page (pml4, upage, pte, kva);
+		intr_set_level (old_level);
+		return true;
+	}
+	intr_set_level (old_level);
+
+	/* This process still holds its reference, so the page stays put
+	 * while it is copied. */
+	copy = palloc_get_page (PAL_USER);
+	if (copy == NULL)
 		return false;
+	memcpy (copy, kva, PGSIZE);
+
+	/* The other sharers may have exited, or taken copies of their
+	 * own, while interrupts were on. */
+	old_level = intr_disable ();
+	if (*cow_ref (kva) <= 1) {
+		reuse_cow_page (pml4, upage, pte, kva);
+		intr_set_level (old_level);
+		palloc_free_page (copy);
+		return true;
 	}
+	if (--*cow_ref (kva) == 0)
+		palloc_free_page (kva);
+	pml4_clear_page (pml4, upage);
+	pml4_set_page (pml4, upage, copy, true);
+	intr_set_level (old_level);
+	fork_stats.copied++;
+	return true;
+}
+
+/* Drops the current process's reference to the shared page mapped
+ * by PTE, unmapping it unless this process is the last to map it,
+ * so that pml4_destroy() frees only pages no one else maps.  Passed
+ * to pml4_for_each(). */
+static bool
+release_shared_pte (uint64_t *pte, void *va, void *aux UNUSED) {
+	void *kva;
+	enum intr_level old_level;
+
+	if (is_kernel_vaddr (va) || !(*pte & PTE_SHARED))
+		return true;
+	kva = ptov (PTE_ADDR (*pte));
+
+	old_level = intr_disable ();
+	if (*cow_ref (kva) > 1) {
+		--*cow_ref (kva);
+		*pte = 0;
+	} else
+		*cow_ref (kva) = 0;
+	intr_set_level (old_level);
 	return true;
 }
+
 #endif
 
+/* Prints exec, spawn, exec cache, descriptor table and fork
+ * statistics. */
+void
+process_print_stats (void) {
+	if (exec_stats.loads > 0)
+		printf ("Exec: %llu loads in %lld ticks (%lld max), %llu text pages "
+				"shared through the page cache\n", exec_stats.loads,
+				exec_stats.load_ticks, exec_stats.load_max,
+				exec_stats.text_pages);
+	if (exec_stats.spawns > 0)
+		printf ("Spawn: %llu processes spawned\n", exec_stats.spawns);
+	exec_cache_print_stats ();
+	fdt_print_stats ();
+#ifndef VM
+	if (fork_stats.forks > 0)
+		printf ("Fork: %llu forks, %llu pages shared, %llu copied on write "
+				"(%llu per fork), %llu reused\n", fork_stats.forks,
+				fork_stats.shared, fork_stats.copied,
+				fork_stats.copied / fork_stats.forks, fork_stats.reused);
+#endif
+}
+
+/* Gives CHILD, whose descriptor table is empty, each of PARENT's
+ * open files under the same descriptor.  The files are shared, not
+ * duplicated: a process takes a private copy of one only when it
+ * first moves its position (see syscall.c), so that parent and child
+ * still keep separate positions.  Returns false if out of memory. */
+static bool
+copy_fds (struct thread *child, struct thread *parent) {
+	int fd;
+
+	if (!fdt_copy (&child->fds, &parent->fds))
+		return false;
+	for (fd = fdt_next (&child->fds, 0); fd >= 0;
+			fd = fdt_next (&child->fds, fd + 1)) {
+		struct file *f = fdt_get (&child->fds, fd);
+
+		if (!fd_is_console (f))
+			file_share (f);
+	}
+	return true;
+}
+
 /* A thread function that copies parent's execution context.
  * Hint) parent->tf does not hold the userland context of the process.
  *       That is, you are required to pass second argument of process_fork to
@@ -167,6 +344,19 @@ __do_fork (void *aux) {
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
 #else
+	if (cow_refs == NULL) {
+		uint16_t *refs = calloc (palloc_user_pages (), sizeof *refs);
+		if (refs == NULL)
+			goto error;
+		enum intr_level old_level = intr_disable ();
+		if (cow_refs == NULL) {
+			cow_refs = refs;
+			refs = NULL;
+		}
+		intr_set_level (old_level);
+		free (refs);
+	}
+	fork_stats.forks++;
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 		goto error;
 #endif
@@ -179,16 +369,8 @@ __do_fork (void *aux) {
 
 	//process_init ();
 	//system call
-	if(parent->fd_idx == FDCOUNT_LIMIT)
+	if(fdt_full(&parent->fds) || !copy_fds (current, parent))
 		goto error;
-	current->fd_table[0] = parent->fd_table[0];
-	current->fd_table[1] = parent->fd_table[1];
-	for(int i = 2; i<FDCOUNT_LIMIT; i++){
-		struct file *f = parent->fd_table[i];
-		if(f == NULL)continue;
-		current->fd_table[i] = file_duplicate(f);
-	}
-	current->fd_idx = parent->fd_idx;
 	sema_up(&current->fork_sema);
 	if_.R.rax = 0;
 	
@@ -204,6 +386,126 @@ error:
 	//thread_exit ();
 }
 
+/* What process_spawn() hands the new process. */
+struct spawn_args {
+	char *cmdline;                      /* Command line, in a page. */
+	struct thread *parent;              /* The spawning process. */
+	const struct spawn_action *actions; /* Descriptor actions. */
+	size_t action_cnt;                  /* Number of ACTIONS. */
+	bool success;                       /* Set once the program loads. */
+};
+
+/* Applies A to the descriptors of T, a process being spawned.
+ * Returns false if A is not a valid action. */
+static bool
+apply_spawn_action (struct thread *t, const struct spawn_action *a) {
+	struct file *f, *old;
+
+	switch (a->type) {
+		case SPAWN_CLOSE:
+			f = fdt_remove (&t->fds, a->fd);
+			if (f != NULL && !fd_is_console (f))
+				file_close (f);
+			return true;
+		case SPAWN_DUP2:
+			if ((f = fdt_get (&t->fds, a->fd)) == NULL || a->newfd < 0
+					|| a->newfd >= FD_MAX)
+				return false;
+			if (a->newfd == a->fd)
+				return true;
+			if (!fd_is_console (f))
+				file_share (f);
+			old = fdt_remove (&t->fds, a->newfd);
+			if (old != NULL && !fd_is_console (old))
+				file_close (old);
+			if (!fdt_install (&t->fds, a->newfd, f)) {
+				if (!fd_is_console (f))
+					file_close (f);
+				return false;
+			}
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* A thread function that starts a spawned process: it takes the
+ * parent's descriptors as its actions say and loads the program,
+ * and never touches the parent's address space. */
+static void
+do_spawn (void *aux) {
+	struct spawn_args *args = aux;
+	struct thread *current = thread_current ();
+	struct intr_frame if_;
+	size_t i;
+
+#ifdef VM
+	supplemental_page_table_init (&current->spt);
+#endif
+	process_init ();
+
+	if (!copy_fds (current, args->parent)) {
+		palloc_free_page (args->cmdline);
+		goto error;
+	}
+	for (i = 0; i < args->action_cnt; i++)
+		if (!apply_spawn_action (current, &args->actions[i])) {
+			palloc_free_page (args->cmdline);
+			goto error;
+		}
+	if (!process_load (args->cmdline, &if_))
+		goto error;
+
+	/* ARGS lives on the parent's stack: done with it. */
+	args->success = true;
+	sema_up (&current->fork_sema);
+	do_iret (&if_);
+	NOT_REACHED ();
+
+error:
+	current->exit_status = TID_ERROR;
+	sema_up (&current->fork_sema);
+	exit (TID_ERROR);
+}
+
+/* Starts a new process running CMDLINE, a program name and its
+ * arguments, the way process_create_initd() does, instead of
+ * duplicating the current process and exec'ing.  The new process
+ * inherits the current one's open files, adjusted by the ACTION_CNT
+ * entries of ACTIONS.  Returns the new process's pid once its
+ * program is loaded, or TID_ERROR if it could not be started. */
+tid_t
+process_spawn (const char *cmdline, const struct spawn_action *actions,
+		size_t action_cnt) {
+	struct spawn_args args;
+	char name[16];
+	tid_t tid;
+
+	args.cmdline = palloc_get_page (0);
+	if (args.cmdline == NULL)
+		return TID_ERROR;
+	strlcpy (args.cmdline, cmdline, PGSIZE);
+	args.parent = thread_current ();
+	args.actions = actions;
+	args.action_cnt = action_cnt;
+	args.success = false;
+
+	/* The thread is named after the program. */
+	strlcpy (name, cmdline, sizeof name);
+	name[strcspn (name, " ")] = '\0';
+
+	tid = thread_create (name, PRI_DEFAULT, do_spawn, &args);
+	if (tid == TID_ERROR) {
+		palloc_free_page (args.cmdline);
+		return TID_ERROR;
+	}
+	sema_down (&get_child (tid)->fork_sema);
+	if (!args.success)
+		return TID_ERROR;
+	exec_stats.spawns++;
+	return tid;
+}
+
 
 
 
@@ -244,22 +546,18 @@ error:
 // }
 
 
-/* Switch the current execution context to the f_name.
- * Returns -1 on fail. */
-int
-process_exec (void *f_name) {
-	char *file_name = f_name;
+/* Replaces the current process's image with the program that
+ * F_NAME, a command line in a page from palloc_get_page(), names,
+ * and frees F_NAME.  Returns true and sets up *IF_ to start the
+ * program if successful, false otherwise. */
+static bool
+process_load (char *f_name, struct intr_frame *if_) {
 	bool success;
-	
-
+	int64_t start, elapsed;
 
-	/* We cannot use the intr_frame in the thread structure.
-	 * This is because when current thread rescheduled,
-	 * it stores the execution information to the member. */
-	struct intr_frame _if;
-	_if.ds = _if.es = _if.ss = SEL_UDSEG;
-	_if.cs = SEL_UCSEG;
-	_if.eflags = FLAG_IF | FLAG_MBS;
+	if_->ds = if_->es = if_->ss = SEL_UDSEG;
+	if_->cs = SEL_UCSEG;
+	if_->eflags = FLAG_IF | FLAG_MBS;
 
 	/* We first kill the current context */
 	process_cleanup ();
@@ -268,11 +566,29 @@ process_exec (void *f_name) {
 	#endif
 
 	/* And then load the binary */
-	success = load (file_name, &_if);
+	start = timer_ticks ();
+	success = load (f_name, if_);
+	elapsed = timer_elapsed (start);
+	exec_stats.loads++;
+	exec_stats.load_ticks += elapsed;
+	if (elapsed > exec_stats.load_max)
+		exec_stats.load_max = elapsed;
+
+	palloc_free_page (f_name);
+	return success;
+}
+
+/* Switch the current execution context to the f_name.
+ * Returns -1 on fail. */
+int
+process_exec (void *f_name) {
+	/* We cannot use the intr_frame in the thread structure.
+	 * This is because when current thread rescheduled,
+	 * it stores the execution information to the member. */
+	struct intr_frame _if;
 
 	/* If load failed, quit. */
-	palloc_free_page (file_name);
-	if (!success)
+	if (!process_load (f_name, &_if))
 		//system call
 		return -1;
 
@@ -324,10 +640,10 @@ process_exit (void) {
 	 * TODO: We recommend you to implement process resource cleanup here. */
 
 	//system call
-	for(int i = 0; i<FDCOUNT_LIMIT; i++)
+	for(int i = 0; i<(int) curr->fds.high; i++)
 		close(i);
 	
-	palloc_free_multiple(curr->fd_table, FDT_PAGES);
+	fdt_destroy(&curr->fds);
 
 	
 	file_close(curr->running);
@@ -362,6 +678,9 @@ process_cleanup (void) {
 		 * that's been freed (and cleared). */
 		curr->pml4 = NULL;
 		pml4_activate (NULL);
+#ifndef VM
+		pml4_for_each (pml4, release_shared_pte, NULL);
+#endif
 		pml4_destroy (pml4);
 	}
 }
@@ -480,61 +799,31 @@ void arg_stack(char ** argv, int argc, struct intr_frame *if_){
 
 }
 
-
-static bool
-load (const char *file_name, struct intr_frame *if_) {
-	struct thread *t = thread_current ();
+/* Reads and verifies the ELF header and program headers of FILE and
+ * lays out its loadable segments.  Returns the result, with a
+ * reference for the caller, or a null pointer if FILE is not a
+ * valid executable or out of memory. */
+static struct exec_image *
+read_image (struct file *file) {
+	struct exec_image *image;
 	struct ELF ehdr;
-	struct file *file = NULL;
 	off_t file_ofs;
-	bool success = false;
 	int i;
 
-
-
-	//argument passing
-	char* arg_list[128];
-	char* token, *save_ptr;
-	int token_cnt = 0;
-	token = strtok_r(file_name, " ", &save_ptr);
-	arg_list[token_cnt] = token;
-
-	while(token != NULL){
-		token = strtok_r(NULL, " ", &save_ptr);
-		token_cnt++;
-		arg_list[token_cnt] = token;
-	}
-
-
-
-	/* Allocate and activate page directory. */
-	t->pml4 = pml4_create ();
-	if (t->pml4 == NULL)
-		goto done;
-	process_activate (thread_current ());
-
-	/* Open executable file. */
-	file = filesys_open (file_name);
-	if (file == NULL) {
-		printf ("load: %s: open failed\n", file_name);
-		goto done;
-	}
-
-	// //system call file
-	t->running = file;
-	file_deny_write(file);
-
 	/* Read and verify executable header. */
+	file_seek (file, 0);
 	if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
 			|| memcmp (ehdr.e_ident, "\177ELF\2\1\1", 7)
 			|| ehdr.e_type != 2
 			|| ehdr.e_machine != 0x3E // amd64
 			|| ehdr.e_version != 1
 			|| ehdr.e_phentsize != sizeof (struct Phdr)
-			|| ehdr.e_phnum > 1024) {
-		printf ("load: %s: error loading executable\n", file_name);
-		goto done;
-	}
+			|| ehdr.e_phnum > 1024)
+		return NULL;
+	image = exec_image_create (ehdr.e_phnum);
+	if (image == NULL)
+		return NULL;
+	image->entry = ehdr.e_entry;
 
 	/* Read program headers. */
 	file_ofs = ehdr.e_phoff;
@@ -542,11 +831,11 @@ load (const char *file_name, struct intr_frame *if_) {
 		struct Phdr phdr;
 
 		if (file_ofs < 0 || file_ofs > file_length (file))
-			goto done;
+			goto fail;
 		file_seek (file, file_ofs);
 
 		if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-			goto done;
+			goto fail;
 		file_ofs += sizeof phdr;
 		switch (phdr.p_type) {
 			case PT_NULL:
@@ -559,42 +848,108 @@ load (const char *file_name, struct intr_frame *if_) {
 			case PT_DYNAMIC:
 			case PT_INTERP:
 			case PT_SHLIB:
-				goto done;
+				goto fail;
 			case PT_LOAD:
 				if (validate_segment (&phdr, file)) {
-					bool writable = (phdr.p_flags & PF_W) != 0;
-					uint64_t file_page = phdr.p_offset & ~PGMASK;
-					uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
+					struct exec_segment *seg = &image->segs[image->seg_cnt++];
 					uint64_t page_offset = phdr.p_vaddr & PGMASK;
-					uint32_t read_bytes, zero_bytes;
+
+					seg->writable = (phdr.p_flags & PF_W) != 0;
+					seg->ofs = phdr.p_offset & ~PGMASK;
+					seg->upage = (void *) (phdr.p_vaddr & ~PGMASK);
 					if (phdr.p_filesz > 0) {
 						/* Normal segment.
 						 * Read initial part from disk and zero the rest. */
-						read_bytes = page_offset + phdr.p_filesz;
-						zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-								- read_bytes);
+						seg->read_bytes = page_offset + phdr.p_filesz;
+						seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+								- seg->read_bytes);
 					} else {
 						/* Entirely zero.
 						 * Don't read anything from disk. */
-						read_bytes = 0;
-						zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+						seg->read_bytes = 0;
+						seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
 					}
-					if (!load_segment (file, file_page, (void *) mem_page,
-								read_bytes, zero_bytes, writable))
-						goto done;
 				}
 				else
-					goto done;
+					goto fail;
 				break;
 		}
 	}
+	return image;
+
+fail:
+	exec_cache_release (image);
+	return NULL;
+}
+
+static bool
+load (const char *file_name, struct intr_frame *if_) {
+	struct thread *t = thread_current ();
+	struct exec_image *image = NULL;
+	struct file *file = NULL;
+	bool success = false;
+	int i;
+
+
+
+	//argument passing
+	char* arg_list[128];
+	char* token, *save_ptr;
+	int token_cnt = 0;
+	token = strtok_r(file_name, " ", &save_ptr);
+	arg_list[token_cnt] = token;
+
+	while(token != NULL){
+		token = strtok_r(NULL, " ", &save_ptr);
+		token_cnt++;
+		arg_list[token_cnt] = token;
+	}
+
+
+
+	/* Allocate and activate page directory. */
+	t->pml4 = pml4_create ();
+	if (t->pml4 == NULL)
+		goto done;
+	process_activate (thread_current ());
+
+	/* Open executable file. */
+	file = filesys_open (file_name);
+	if (file == NULL) {
+		printf ("load: %s: open failed\n", file_name);
+		goto done;
+	}
+
+	// //system call file
+	t->running = file;
+	file_deny_write(file);
+
+	/* Parse the executable, unless it was parsed lately. */
+	image = exec_cache_lookup (file_get_inode (file));
+	if (image == NULL) {
+		image = read_image (file);
+		if (image == NULL) {
+			printf ("load: %s: error loading executable\n", file_name);
+			goto done;
+		}
+		exec_cache_insert (file_get_inode (file), image);
+	}
+
+	/* Load the segments. */
+	for (i = 0; i < (int) image->seg_cnt; i++) {
+		const struct exec_segment *seg = &image->segs[i];
+
+		if (!load_segment (file, seg->ofs, seg->upage, seg->read_bytes,
+					seg->zero_bytes, seg->writable))
+			goto done;
+	}
 
 	/* Set up stack. */
 	if (!setup_stack (if_))
 		goto done;
 
 	/* Start address. */
-	if_->rip = ehdr.e_entry;
+	if_->rip = image->entry;
 
 	/* TODO: Your code goes here.
 	 * TODO: Implement argument passing (see project2/argument_passing.html). */
@@ -606,6 +961,7 @@ load (const char *file_name, struct intr_frame *if_) {
 
 done:
 	/* We arrive here whether the load is successful or not. */
+	exec_cache_release (image);
 	//system call
 	//file_close (file);
 	return success;
@@ -776,7 +1132,6 @@ install_page (void *upage, void *kpage, bool writable) {
 /* From here, codes will be used after project 3.
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
-struct lock* filesys_lock;
 
 static bool
 lazy_load_segment(struct page *page, void *aux)
@@ -784,20 +1139,11 @@ lazy_load_segment(struct page *page, void *aux)
     /* TODO: Load the segment from the file */
     /* TODO: This called when the first page fault occurs on address VA. */
     /* TODO: VA is available when calling this function. */
-    bool success = true;
     struct load_segment_aux *info = (struct load_segment_aux *)aux;
-    if (file_read_at(info->file, page->va, info->page_read_bytes, info->ofs) != (off_t)info->page_read_bytes)
-    {
-        vm_dealloc_page(page);
-        success = false;
-    }
-    else
-    {
-        memset((page->va) + info->page_read_bytes, 0, info->page_zero_bytes);
-    }
+    bool success = vm_lazy_read(&info->load, page->frame->kva);
 
-    file_close(info->file);
-    free(aux);
+    file_close(info->load.file);
+    slab_free(load_aux_slab, aux);
     return success;
 }
 static bool
@@ -808,6 +1154,17 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
     ASSERT(pg_ofs(upage) == 0);
     ASSERT(ofs % PGSIZE == 0);
 
+    /* Every page of the segment loads through one handle on the
+     * file, each page holding a share of it. */
+    struct file *seg_file;
+    bool success = true;
+
+    lock_acquire(&filesys_lock);
+    seg_file = file_reopen(file);
+    lock_release(&filesys_lock);
+    if (seg_file == NULL)
+        return false;
+
     off_t dynamic_ofs = ofs;
     while (read_bytes > 0 || zero_bytes > 0)
     {
@@ -817,21 +1174,55 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
         size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
         size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+        /* Pages with nothing to read are plain zero-fill pages. */
+        if (page_read_bytes == 0)
+        {
+            if (!vm_alloc_page(VM_ANON, upage, writable))
+            {
+                success = false;
+                break;
+            }
+            upage += PGSIZE;
+            zero_bytes -= page_zero_bytes;
+            dynamic_ofs += PGSIZE;
+            continue;
+        }
+
+        /* Whole read-only pages are loaded through the page cache,
+         * where every process running this executable finds them. */
+        if (!writable && page_read_bytes == PGSIZE)
+        {
+            if (!file_backed_alloc_text(upage, file_share(seg_file),
+                                        dynamic_ofs))
+            {
+                file_close(seg_file);
+                success = false;
+                break;
+            }
+            exec_stats.text_pages++;
+            read_bytes -= PGSIZE;
+            upage += PGSIZE;
+            dynamic_ofs += PGSIZE;
+            continue;
+        }
+
         /* TODO: Set up aux to pass information to the lazy_load_segment. */
-        struct load_segment_aux *aux = (struct load_segment_aux *)malloc(sizeof(struct load_segment_aux));
-        lock_acquire(&filesys_lock);
-        aux->file = file_reopen(file);
-        lock_release(&filesys_lock);
-        aux->ofs = dynamic_ofs;
-        aux->page_read_bytes = page_read_bytes;
-        aux->page_zero_bytes = page_zero_bytes;
-
-        if (!vm_alloc_page_with_initializer(VM_ANON, upage,
+        struct load_segment_aux *aux = slab_alloc(load_aux_slab);
+        if (aux == NULL)
+        {
+            success = false;
+            break;
+        }
+        vm_lazy_init(&aux->load, file_share(seg_file), dynamic_ofs,
+                     page_read_bytes);
+
+        if (!vm_alloc_page_with_initializer(VM_ANON | VM_LAZY_FILE, upage,
                                             writable, lazy_load_segment, (void *)aux))
         {
-            file_close(aux->file);
-            free(aux);
-            return false;
+            file_close(aux->load.file);
+            slab_free(load_aux_slab, aux);
+            success = false;
+            break;
         }
 
         /* Advance. */
@@ -840,7 +1231,8 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
         upage += PGSIZE;
         dynamic_ofs += PGSIZE;
     }
-    return true;
+    file_close(seg_file);
+    return success;
 }
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
 static bool
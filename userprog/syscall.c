@@ -1,5 +1,6 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -12,9 +13,16 @@
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include <list.h>
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "userprog/process.h"
+#include "devices/input.h"
+#include <limits.h>
+#include <round.h>
+#ifdef VM
+#include "vm/vma.h"
+#endif
 
 
 void syscall_entry (void);
@@ -39,14 +47,30 @@ void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
 int dup2 (int oldfd, int newfd);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned size, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned size, off_t offset);
+int preadv (int fd, const struct iovec *iov, int iovcnt, off_t offset);
+int pwritev (int fd, const struct iovec *iov, int iovcnt, off_t offset);
+int sendfile (int out_fd, int in_fd, unsigned size);
 
 
 tid_t fork (const char *thread_name);
 //tid_t fork (const char *thread_name, struct intr_frame *f);
 int exec (const char *file);
+tid_t spawn (const char *cmdline, const struct spawn_action *actions,
+		size_t action_cnt);
+#ifdef VM
+void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+int msync (void *addr, size_t length);
+#endif
 
 //file descripter
 static struct file *find_file_by_fd(int fd);
+static struct file *own_file_by_fd(int fd);
 int add_file_to_fdt(struct file *file);
 void remove_file_from_fdt(int fd);
 
@@ -98,49 +122,60 @@ void check_addr(const uint64_t* tmp_addr){
 	// if(tmp_addr == NULL || !is_user_vaddr(tmp_addr) || pml4_get_page(cur->pml4, tmp_addr) == NULL)
 	// 	exit(-1);
 
+#ifdef VM
+	/* Valid pages need not be resident: they may not have been
+	 * loaded yet, or may have been evicted. */
+	if(tmp_addr == NULL || is_kernel_vaddr(tmp_addr)
+			|| (spt_find_page(&cur->spt, (void *) tmp_addr) == NULL
+				&& vma_find(&cur->spt, tmp_addr) == NULL))
+		exit(-1);
+#else
 	if(pml4_get_page(cur->pml4, tmp_addr) == NULL)
 		exit(-1);
+#endif
 }
 
 
 static struct file *find_file_by_fd(int fd){
-	if(fd<0 || fd >= FDCOUNT_LIMIT)return NULL;
-	struct thread *cur = thread_current();
-	return cur->fd_table[fd];
+	return fdt_get(&thread_current()->fds, fd);
+}
+
+/* Returns the file open as FD, as find_file_by_fd() does, for a use
+ * that moves its position.  A file still shared with another process
+ * since a fork is first replaced by a private copy, since processes
+ * keep separate positions. */
+static struct file *own_file_by_fd(int fd){
+	struct fd_table *fds = &thread_current()->fds;
+	struct file *file = fdt_get(fds, fd);
+	struct file *copy;
+
+	if(file == NULL || fd_is_console(file) || !file_is_shared(file))
+		return file;
+	if((copy = file_duplicate(file)) == NULL)
+		return NULL;
+	fdt_remove(fds, fd);
+	fdt_install(fds, fd, copy);
+	file_close(file);
+	return copy;
 }
 
 int add_file_to_fdt(struct file *file){
-	struct thread *cur = thread_current();
-	struct file **fdt = cur->fd_table;
-
-	// while(cur->fd_idx < FDCOUNT_LIMIT && fdt[cur->fd_idx])
-	// 	cur->fd_idx++;
-
-	// if(cur->fd_idx >= FDCOUNT_LIMIT)return -1;
-	// fdt[cur->fd_idx] = file;
-	// return cur->fd_idx;
-	for(int idx = cur->fd_idx; idx <FDCOUNT_LIMIT; idx++){
-		if(fdt[idx] == NULL){
-			fdt[idx] = file;
-			cur->fd_idx = idx;
-			return cur->fd_idx;
-		}
-	}
-	cur->fd_idx = FDCOUNT_LIMIT;
-	return -1;
+	return fdt_alloc(&thread_current()->fds, file);
 }
 
 void remove_file_from_fdt(int fd){
-	if(fd<0 || fd >= FDCOUNT_LIMIT)return;
-	struct thread *cur = thread_current();
-	cur->fd_table[fd] = NULL;
+	fdt_remove(&thread_current()->fds, fd);
 }
 
-
 void
 syscall_handler (struct intr_frame *f UNUSED) {
 	// TODO: Your implementation goes here.
 	int syscall_num = f->R.rax; // rax: system call number
+#ifdef VM
+	/* Page faults taken inside the system call need the user stack
+	 * pointer to tell stack growth from stray accesses. */
+	thread_current ()->user_rsp = f->rsp;
+#endif
 	switch(syscall_num){
 		case SYS_HALT:                   /* Halt the operating system. */
 			halt();
@@ -157,6 +192,10 @@ syscall_handler (struct intr_frame *f UNUSED) {
 			if (exec(f->R.rdi) == -1)
 				exit(-1);
 			break;
+		case SYS_SPAWN:                  /* Start a process running a program. */
+			f->R.rax = spawn((const char *) f->R.rdi,
+					(const struct spawn_action *) f->R.rsi, f->R.rdx);
+			break;
 		case SYS_WAIT:                   /* Wait for a child process to die. */
 			f->R.rax = process_wait(f->R.rdi);
 			break;
@@ -190,6 +229,41 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case SYS_DUP2:
 			f->R.rax = dup2(f->R.rdi, f->R.rsi);
 			break;
+		case SYS_READV:                  /* Read from a file into several buffers. */
+			f->R.rax = readv(f->R.rdi, (void *) f->R.rsi, f->R.rdx);
+			break;
+		case SYS_WRITEV:                 /* Write several buffers to a file. */
+			f->R.rax = writev(f->R.rdi, (void *) f->R.rsi, f->R.rdx);
+			break;
+		case SYS_PREAD:                  /* Read from a file at an offset. */
+			f->R.rax = pread(f->R.rdi, (void *) f->R.rsi, f->R.rdx, f->R.r10);
+			break;
+		case SYS_PWRITE:                 /* Write to a file at an offset. */
+			f->R.rax = pwrite(f->R.rdi, (void *) f->R.rsi, f->R.rdx, f->R.r10);
+			break;
+		case SYS_PREADV:                 /* readv() at an offset. */
+			f->R.rax = preadv(f->R.rdi, (void *) f->R.rsi, f->R.rdx, f->R.r10);
+			break;
+		case SYS_PWRITEV:                /* writev() at an offset. */
+			f->R.rax = pwritev(f->R.rdi, (void *) f->R.rsi, f->R.rdx, f->R.r10);
+			break;
+		case SYS_SENDFILE:               /* Copy between files in the kernel. */
+			f->R.rax = sendfile(f->R.rdi, f->R.rsi, f->R.rdx);
+			break;
+#ifdef VM
+		case SYS_MMAP:                   /* Map a file into memory. */
+			f->R.rax = (uint64_t) mmap((void *) f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
+			break;
+		case SYS_MUNMAP:                 /* Remove a memory mapping. */
+			munmap((void *) f->R.rdi);
+			break;
+		case SYS_MADVISE:                /* Give an access hint for a mapping. */
+			f->R.rax = madvise((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+			break;
+		case SYS_MSYNC:                  /* Write a mapping's dirty pages back. */
+			f->R.rax = msync((void *) f->R.rdi, f->R.rsi);
+			break;
+#endif
 		default:						 /* call thread_exit() ? */
 			exit(-1);
 			break;
@@ -253,7 +327,8 @@ close(int fd){
 	struct file *fileobj = find_file_by_fd(fd);
 	if(fileobj == NULL)return;
 	remove_file_from_fdt(fd);
-	file_close(fileobj);
+	if(!fd_is_console(fileobj))
+		file_close(fileobj);
 }
 
 
@@ -275,7 +350,7 @@ read (int fd, void *buffer, unsigned size){
 	//if(fd<0 || fd>=FDCOUNT_LIMIT)return -1;
 	
 
-	struct file *tmpf = find_file_by_fd(fd);
+	struct file *tmpf = own_file_by_fd(fd);
 	if(tmpf == NULL)return -1;
 	if(tmpf == STDOUT)return -1;
 	int readsize;//
@@ -303,9 +378,8 @@ read (int fd, void *buffer, unsigned size){
 int 
 write (int fd, const void *buffer, unsigned size){
 	check_addr(buffer);
-	if(fd < 0 || fd >= FDCOUNT_LIMIT)return -1;
 	int writesize;
-	struct file *tmpf = find_file_by_fd(fd);
+	struct file *tmpf = own_file_by_fd(fd);
 	if(tmpf == NULL || tmpf == STDIN)return -1;
 	
 	if(tmpf == STDOUT){
@@ -322,6 +396,196 @@ write (int fd, const void *buffer, unsigned size){
 }
 
 
+/* Checks every page of the SIZE bytes at BUFFER, terminating the
+ * process if any is not a valid user page. */
+static void
+check_buffer (const void *buffer, size_t size) {
+	const uint8_t *end = (const uint8_t *) buffer + size;
+	const uint8_t *p;
+
+	if (size == 0)
+		return;
+	if (end < (const uint8_t *) buffer)
+		exit(-1);
+	for (p = pg_round_down (buffer); p < end; p += PGSIZE)
+		check_addr(p < (const uint8_t *) buffer ? buffer : (const void *) p);
+}
+
+/* Copies the IOVCNT entries of the user array UIOV into KIOV and
+ * checks the buffers they name, once, before any is used.  Returns
+ * false if IOVCNT is out of range or the buffers add up to more
+ * than a return value can count. */
+static bool
+copy_iov (struct iovec *kiov, const struct iovec *uiov, int iovcnt) {
+	size_t total = 0;
+	int i;
+
+	if (iovcnt < 0 || iovcnt > IOV_MAX)
+		return false;
+	if (iovcnt == 0)
+		return true;
+	check_buffer(uiov, iovcnt * sizeof *uiov);
+	memcpy(kiov, uiov, iovcnt * sizeof *uiov);
+	for (i = 0; i < iovcnt; i++) {
+		if (kiov[i].iov_len > INT_MAX - total)
+			return false;
+		total += kiov[i].iov_len;
+		check_buffer(kiov[i].iov_base, kiov[i].iov_len);
+	}
+	return true;
+}
+
+/* Moves bytes between the file open as FD and the IOVCNT checked
+ * buffers of IOV, in order: out of them if WRITING, into them if
+ * not.  A POSITIONAL transfer starts at OFS and leaves the file's
+ * position alone; any other starts at the position and advances it.
+ * The file system lock is taken once for the whole transfer, which
+ * stops at the first short one.  Returns the bytes moved, or -1 if
+ * FD is not open for it. */
+static int
+rw_vec (int fd, const struct iovec *iov, int iovcnt, bool positional,
+		off_t ofs, bool writing) {
+	struct file *file = positional ? find_file_by_fd(fd) : own_file_by_fd(fd);
+	int total = 0, i;
+
+	if (file == NULL || (positional && (fd_is_console(file) || ofs < 0)))
+		return -1;
+	if (file == FD_STDOUT) {
+		if (!writing)
+			return -1;
+		for (i = 0; i < iovcnt; i++) {
+			putbuf(iov[i].iov_base, iov[i].iov_len);
+			total += iov[i].iov_len;
+		}
+		return total;
+	}
+	if (file == FD_STDIN) {
+		if (writing)
+			return -1;
+		for (i = 0; i < iovcnt; i++) {
+			uint8_t *p = iov[i].iov_base;
+			size_t n;
+
+			for (n = 0; n < iov[i].iov_len; n++)
+				*p++ = input_getc();
+			total += iov[i].iov_len;
+		}
+		return total;
+	}
+
+	lock_acquire(&filesys_lock);
+	if (!positional)
+		ofs = file_tell(file);
+	for (i = 0; i < iovcnt; i++) {
+		off_t n = writing
+			? file_write_at(file, iov[i].iov_base, iov[i].iov_len, ofs)
+			: file_read_at(file, iov[i].iov_base, iov[i].iov_len, ofs);
+
+		ofs += n;
+		total += n;
+		if ((size_t) n != iov[i].iov_len)
+			break;
+	}
+	if (!positional)
+		file_seek(file, ofs);
+	lock_release(&filesys_lock);
+	return total;
+}
+
+/* Reads from the file open as FD into the IOVCNT buffers of IOV in
+ * turn, as one read() would.  Returns the bytes read, or -1. */
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	struct iovec kiov[IOV_MAX];
+
+	if (!copy_iov(kiov, iov, iovcnt))
+		return -1;
+	return rw_vec(fd, kiov, iovcnt, false, 0, false);
+}
+
+/* Writes the IOVCNT buffers of IOV in turn to the file open as FD,
+ * as one write() would.  Returns the bytes written, or -1. */
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	struct iovec kiov[IOV_MAX];
+
+	if (!copy_iov(kiov, iov, iovcnt))
+		return -1;
+	return rw_vec(fd, kiov, iovcnt, false, 0, true);
+}
+
+/* Reads SIZE bytes from the file open as FD, starting at OFFSET,
+ * into BUFFER without moving its position.  Returns the bytes read,
+ * or -1. */
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	struct iovec iov = { buffer, size };
+
+	if (size > INT_MAX)
+		return -1;
+	check_buffer(buffer, size);
+	return rw_vec(fd, &iov, 1, true, offset, false);
+}
+
+/* Writes SIZE bytes from BUFFER to the file open as FD, starting at
+ * OFFSET, without moving its position.  Returns the bytes written,
+ * or -1. */
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	struct iovec iov = { (void *) buffer, size };
+
+	if (size > INT_MAX)
+		return -1;
+	check_buffer(buffer, size);
+	return rw_vec(fd, &iov, 1, true, offset, true);
+}
+
+/* readv() starting at OFFSET, without moving the file's position. */
+int
+preadv (int fd, const struct iovec *iov, int iovcnt, off_t offset) {
+	struct iovec kiov[IOV_MAX];
+
+	if (!copy_iov(kiov, iov, iovcnt))
+		return -1;
+	return rw_vec(fd, kiov, iovcnt, true, offset, false);
+}
+
+/* writev() starting at OFFSET, without moving the file's position. */
+int
+pwritev (int fd, const struct iovec *iov, int iovcnt, off_t offset) {
+	struct iovec kiov[IOV_MAX];
+
+	if (!copy_iov(kiov, iov, iovcnt))
+		return -1;
+	return rw_vec(fd, kiov, iovcnt, true, offset, true);
+}
+
+/* Copies up to SIZE bytes from the file open as IN_FD, starting at
+ * its position, to the file open as OUT_FD at its position, without
+ * passing through user memory, and advances both positions.  Returns
+ * the bytes copied, or -1 if either descriptor is not an open file
+ * or the two ranges overlap within one file. */
+int
+sendfile (int out_fd, int in_fd, unsigned size) {
+	struct file *out = own_file_by_fd(out_fd);
+	struct file *in = own_file_by_fd(in_fd);
+	int copied = -1;
+
+	if (out == NULL || in == NULL || fd_is_console(out) || fd_is_console(in))
+		return -1;
+	if (size > INT_MAX)
+		size = INT_MAX;
+
+	lock_acquire(&filesys_lock);
+	if (file_get_inode(out) != file_get_inode(in)
+			|| (int64_t) file_tell(out) >= (int64_t) file_tell(in) + size
+			|| (int64_t) file_tell(in) >= (int64_t) file_tell(out) + size)
+		copied = file_copy(out, in, size);
+	lock_release(&filesys_lock);
+	return copied;
+}
+
+
 tid_t
 fork (const char *thread_name){
 	struct thread* cur = thread_current();
@@ -334,7 +598,7 @@ exec (const char *file) {
 	check_addr(file);
 	int file_size = strlen(file) + 1;
 	//file_length로 사용하면 문제가 발생하나?
-	struct file *file_copy = palloc_get_page(PAL_ZERO);
+	char *file_copy = palloc_get_page(PAL_ZERO);
 	if(file_copy == NULL)exit(-1);
 	strlcpy(file_copy, file, file_size);
 	if(process_exec(file_copy) == -1)return -1;
@@ -343,13 +607,38 @@ exec (const char *file) {
 
 }
 
-
+/* Starts a new process running CMDLINE, with the caller's open
+ * files except as the ACTION_CNT entries of ACTIONS change them,
+ * without copying the caller's address space.  Returns the new
+ * process's pid, or -1 if it could not be started. */
+tid_t
+spawn (const char *cmdline, const struct spawn_action *actions,
+		size_t action_cnt) {
+	struct spawn_action *copy = NULL;
+	size_t size = action_cnt * sizeof *actions;
+	tid_t tid;
+
+	check_addr ((const uint64_t *) cmdline);
+	if (action_cnt > SPAWN_ACTIONS_MAX)
+		return -1;
+	if (action_cnt > 0) {
+		/* The new process cannot see this one's memory. */
+		check_buffer (actions, size);
+		copy = malloc (size);
+		if (copy == NULL)
+			return -1;
+		memcpy (copy, actions, size);
+	}
+	tid = process_spawn (cmdline, copy, action_cnt);
+	free (copy);
+	return tid;
+}
 
 
 void
 seek (int fd, unsigned position) {
-	if(fd < 2 || fd > FDCOUNT_LIMIT)return;
-	struct file *fileobj = thread_current()->fd_table[fd];
+	if(fd < 2)return;
+	struct file *fileobj = own_file_by_fd(fd);
 	if(fileobj == NULL)return;
 	if(fileobj <= 2)return;
 	//fileobj->pos = position;
@@ -359,9 +648,8 @@ seek (int fd, unsigned position) {
 
 unsigned
 tell (int fd) {
-	if(fd < 0 || fd > FDCOUNT_LIMIT)return -1;
-	struct file *fileobj = thread_current()->fd_table[fd];
-	if(fileobj < 2)return ;
+	struct file *fileobj = find_file_by_fd(fd);
+	if(fileobj == NULL || fd_is_console(fileobj))return -1;
 	return file_tell(fileobj);
 }
 
@@ -370,6 +658,62 @@ dup2 (int oldfd, int newfd){
 	
 }
 
+#ifdef VM
+/* Maps LENGTH bytes of the file open as FD, starting at OFFSET,
+ * at ADDR.  Returns ADDR, or a null pointer if the arguments are
+ * bad or the range overlaps an existing page. */
+void *
+mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct file *fileobj = find_file_by_fd(fd);
+
+	if (addr == NULL || pg_ofs (addr) != 0 || offset % PGSIZE != 0
+			|| length == 0 || is_kernel_vaddr (addr)
+			|| is_kernel_vaddr ((uint8_t *) addr + length - 1)
+			|| (uint8_t *) addr + length < (uint8_t *) addr)
+		return NULL;
+	if (fileobj == NULL || fd_is_console (fileobj)
+			|| file_length (fileobj) == 0)
+		return NULL;
+	if (!spt_range_free (spt, addr,
+				(uint8_t *) addr + ROUND_UP (length, PGSIZE)))
+		return NULL;
+	return do_mmap (addr, length, writable, fileobj, offset);
+}
+
+void
+munmap (void *addr) {
+	do_munmap (addr);
+}
+
+/* Applies ADVICE, one of the MADV_* hints, to the LENGTH bytes of
+ * file mappings starting at ADDR.  Returns 0 if successful, -1 if
+ * the arguments are bad or part of the range is not mapped from a
+ * file. */
+int
+madvise (void *addr, size_t length, int advice) {
+	if (pg_ofs (addr) != 0 || is_kernel_vaddr (addr)
+			|| (uint8_t *) addr + length < (uint8_t *) addr
+			|| (length > 0 && is_kernel_vaddr ((uint8_t *) addr + length - 1))
+			|| advice < MADV_NORMAL || advice > MADV_DONTNEED)
+		return -1;
+	return do_madvise (addr, length, advice);
+}
+
+/* Writes the dirty pages among the LENGTH bytes of file mappings
+ * starting at ADDR back to their files.  Returns 0 if successful,
+ * -1 if the arguments are bad or part of the range is not mapped
+ * from a file. */
+int
+msync (void *addr, size_t length) {
+	if (pg_ofs (addr) != 0 || is_kernel_vaddr (addr)
+			|| (uint8_t *) addr + length < (uint8_t *) addr
+			|| (length > 0 && is_kernel_vaddr ((uint8_t *) addr + length - 1)))
+		return -1;
+	return do_msync (addr, length);
+}
+#endif
+
 
 /*********************************************/
 
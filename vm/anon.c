@@ -1,9 +1,12 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
-#include <bitmap.h>
+#include <string.h>
 
 #include "vm/vm.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
 #include "devices/disk.h"
+#include "threads/vaddr.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -20,18 +23,13 @@ static const struct page_operations anon_ops = {
 };
 
 
-static struct bitmap *disk_bitmap;
-static struct lock bitmap_lock;
-extern struct list lru;
-extern struct lock lru_lock;
-
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
-	disk_bitmap = bitmap_create((size_t)disk_bitmap);
-	lock_init(&bitmap_lock);
+	swap_disk = disk_get (1, 1);
+	swap_init (swap_disk);
+	zswap_init ();
 }
 
 /* Initialize the file mapping */
@@ -42,75 +40,112 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 
 	struct anon_page *anon_page = &page->anon;
 	//vm 관련 anon 추가 사항
-	anon_page->sec_no = SIZE_MAX;
+	anon_page->slot = SWAP_SLOT_NONE;
 	anon_page->thread = thread_current();
+	/* Frames are recycled by eviction, so clear out the old owner's
+	 * data before this page becomes visible.  A page loaded from a
+	 * file is filled in full by vm_lazy_read() instead. */
+	if (!(type & VM_LAZY_FILE))
+		memset (kva, 0, PGSIZE);
 	return true;
 }
 
-
-/***************************************test code spttablecopy ***************************************/
-
-void m_anon_destroy(struct page *page){
-	/*TODO find fram which connect to page*/
-	struct frame *frame = page->frame;
-
-	/*TODO find frame in lru list and remove it and carful to use lock
-	and free frame*/
-	lock_acquire(&lru_lock);
-	list_remove(&frame->lru_elem);
-	lock_release(&lru_lock);
-
-	free(frame);
-
-	/*TODO if anon page secno is not SEC_MAX
-	use bitmap_set_multiple(disk_bitmap, anon_secno, 8, false)*/
-	if(page->anon.sec_no != SIZE_MAX){
-		bitmap_set_multiple(disk_bitmap, page->anon.sec_no, 8, false);
+/* Swap in the page by read contents from the swap disk.
+ *
+ * Pages evicted together sit in consecutive slots, so if the pages
+ * that follow PAGE in the address space are swapped out to the
+ * slots that follow its slot, they are read in the same transfer,
+ * as long as free frames are at hand for them. */
+static bool
+anon_swap_in (struct page *page, void *kva) {
+	struct anon_page *anon_page = &page->anon;
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *pages[SWAP_READAHEAD];
+	struct frame *frames[SWAP_READAHEAD];
+	void *kvas[SWAP_READAHEAD];
+	size_t slot = anon_page->slot;
+	size_t cnt, i;
+
+	if (slot == SWAP_SLOT_NONE)
+		return false;
+
+	kvas[0] = kva;
+	for (cnt = 1; cnt < SWAP_READAHEAD; cnt++) {
+		struct page *next = spt_find_page (spt,
+				(uint8_t *) page->va + cnt * PGSIZE);
+		if (next == NULL || next->operations != &anon_ops
+				|| next->frame != NULL || next->anon.slot != slot + cnt)
+			break;
+		frames[cnt] = vm_get_free_frame ();
+		if (frames[cnt] == NULL)
+			break;
+		pages[cnt] = next;
+		kvas[cnt] = frames[cnt]->kva;
 	}
-}
 
+	swap_read (slot, kvas, cnt);
+	swap_free (slot, 1);
+	anon_page->slot = SWAP_SLOT_NONE;
 
-/***************************************test code spttablecopy ***************************************/
+	for (i = 1; i < cnt; i++)
+		if (vm_map_frame (pages[i], frames[i])) {
+			swap_free (slot + i, 1);
+			pages[i]->anon.slot = SWAP_SLOT_NONE;
+		}
+	return true;
+}
 
-/* Swap in the page by read contents from the swap disk. */
-static bool
-anon_swap_in (struct page *page, void *kva) {
-	struct anon_page *anon_page = &page->anon;
+/* Writes the CNT anonymous PAGES, which must be resident and
+ * pinned, to swap.  Pages are written in order, as few transfers
+ * as free runs of slots allow.  Every page sharing a frame with
+ * one of PAGES gets the same slot.  Returns the number of pages
+ * written, which is less than CNT only if swap fills up. */
+size_t
+anon_swap_out_cluster (struct page *pages[], size_t cnt) {
+	size_t done = 0;
+
+	while (done < cnt) {
+		const void *kvas[SWAP_CLUSTER];
+		size_t n = cnt - done < SWAP_CLUSTER ? cnt - done : SWAP_CLUSTER;
+		size_t slot, i;
+
+		while ((slot = swap_alloc (n)) == SWAP_SLOT_NONE)
+			if ((n /= 2) == 0)
+				return done;
+
+		for (i = 0; i < n; i++) {
+			ASSERT (pages[done + i]->operations == &anon_ops);
+			kvas[i] = pages[done + i]->frame->kva;
+		}
+		swap_write (slot, kvas, n);
+		for (i = 0; i < n; i++) {
+			struct page *p;
+			for (p = pages[done + i]; p != NULL; p = p->next_share) {
+				if (p != pages[done + i])
+					swap_dup (slot + i);
+				p->anon.slot = slot + i;
+			}
+		}
+		done += n;
+	}
+	return done;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+	return anon_swap_out_cluster (&page, 1) == 1;
 }
 
-// /* Destroy the anonymous page. PAGE will be freed by the caller. */
-// static void
-// anon_destroy (struct page *page) {
-// 	struct anon_page *anon_page = &page->anon;
-// }
-
-
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy(struct page *page)
 {
     struct anon_page *anon_page = &page->anon;
-    if (page->frame != NULL)
-    {
-        //printf("!!!!!!!!!!!!!!!!anon_destroy: %s!!!!!!!!!!!!!!!!\n", thread_current()->name);
-        // printf("remove: %p, kva:%p\n", page->va, page->frame->kva);
-        // printf("list_size: %d, list: %p\n", list_size(&lru), &lru);
-
-        lock_acquire(&lru_lock);
-        list_remove(&page->frame->lru_elem);
-        lock_release(&lru_lock);
-
-        // printf("anon_destroy: list: %p\n", &lru);
-
-        // pte write bit 1 -> free
-        free(page->frame);
-    }
-    if (anon_page->sec_no != SIZE_MAX)
-        bitmap_set_multiple(disk_bitmap, anon_page->sec_no, 8, false);
-}
\ No newline at end of file
+    struct frame *frame = vm_take_frame (page);
+
+    if (frame != NULL)
+        vm_free_frame (frame);
+    if (anon_page->slot != SWAP_SLOT_NONE)
+        swap_free (anon_page->slot, 1);
+}
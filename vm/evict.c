@@ -0,0 +1,572 @@
+/* evict.c: Page replacement policies.
+ *
+ * Three policies implement struct evict_policy:
+ *
+ *   clock     Second-chance clock over all evictable frames.
+ *
+ *   2q        Johnson and Shasha's 2Q.  Pages enter a FIFO (A1in)
+ *             on first use and are evicted from it without regard
+ *             to references, which filters out one-pass scans.  The
+ *             identities of pages evicted from A1in are remembered
+ *             in a ghost FIFO (A1out); a page that faults back in
+ *             while still remembered is hot and goes to Am, which
+ *             is managed as a second-chance clock.
+ *
+ *   clockpro  Jiang, Chen and Zhang's CLOCK-Pro.  Resident pages
+ *             are hot or cold; a cold page gets a test period when
+ *             it is referenced, and is promoted to hot if it is
+ *             referenced again (or faults back in, tracked by a
+ *             ghost entry) within it.  A cold hand evicts
+ *             unreferenced cold pages, a hot hand demotes
+ *             unreferenced hot pages and ends test periods, and the
+ *             target number of cold pages adapts to how often test
+ *             periods pay off.
+ *
+ * References come from two places: the accessed bits the sampling
+ * thread reports through on_access (kept as F_REF), and the
+ * accessed bit itself, read and cleared when a hand passes. */
+
+#include "vm/evict.h"
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "vm/vm.h"
+
+/* Bits in struct frame's policy_flags. */
+#define F_REF   0x1             /* Referenced at a sample. */
+#define F_HOT   0x2             /* 2Q: in Am.  CLOCK-Pro: hot page. */
+#define F_TEST  0x4             /* CLOCK-Pro: cold page in test period. */
+
+/* Returns true if F was referenced since the last time a hand
+ * passed it, and clears that state. */
+static bool
+referenced (struct frame *f) {
+	bool ref = vm_frame_referenced (f) || (f->policy_flags & F_REF);
+	f->policy_flags &= ~F_REF;
+	return ref;
+}
+
+static void
+mark_referenced (struct frame *f, bool accessed) {
+	if (accessed)
+		f->policy_flags |= F_REF;
+}
+
+/* A circular list of frames with a single hand. */
+struct ring {
+	struct list list;
+	struct list_elem *hand;     /* Next frame to examine, or null. */
+	size_t cnt;
+};
+
+static void
+ring_init (struct ring *r) {
+	list_init (&r->list);
+	r->hand = NULL;
+	r->cnt = 0;
+}
+
+/* Returns the element after E in R, wrapping around. */
+static struct list_elem *
+ring_next (struct ring *r, struct list_elem *e) {
+	e = list_next (e);
+	return e != list_end (&r->list) ? e : list_begin (&r->list);
+}
+
+/* Inserts F just behind R's hand, making it the last frame the
+ * hand reaches. */
+static void
+ring_insert (struct ring *r, struct frame *f) {
+	if (r->hand == NULL) {
+		list_push_back (&r->list, &f->policy_elem);
+		r->hand = &f->policy_elem;
+	} else
+		list_insert (r->hand, &f->policy_elem);
+	r->cnt++;
+}
+
+static void
+ring_remove (struct ring *r, struct frame *f) {
+	if (r->hand == &f->policy_elem) {
+		r->hand = ring_next (r, r->hand);
+		if (r->hand == &f->policy_elem)
+			r->hand = NULL;
+	}
+	list_remove (&f->policy_elem);
+	r->cnt--;
+}
+
+/* Returns the frame under R's hand and advances the hand. */
+static struct frame *
+ring_step (struct ring *r) {
+	struct frame *f = list_entry (r->hand, struct frame, policy_elem);
+	r->hand = ring_next (r, r->hand);
+	return f;
+}
+
+/* Sweeps R's hand until it finds an unreferenced frame, giving
+ * referenced frames a second chance.  Gives up after two full
+ * sweeps and returns the frame under the hand.  *SCANS and
+ * *CHANCES count frames examined and passed over. */
+static struct frame *
+ring_second_chance (struct ring *r, unsigned long long *scans,
+		unsigned long long *chances) {
+	size_t budget = 2 * r->cnt;
+
+	while (r->hand != NULL) {
+		struct frame *f = ring_step (r);
+		(*scans)++;
+		if (budget-- == 0 || !referenced (f))
+			return f;
+		(*chances)++;
+	}
+	return NULL;
+}
+
+/* Identity of a page that is no longer resident.  A process's
+ * ghosts are forgotten when its page table is torn down, so PML4
+ * cannot be recycled under a ghost. */
+struct ghost {
+	uint64_t *pml4;             /* Owning page table. */
+	void *va;                   /* User virtual address. */
+	struct hash_elem hash_elem; /* Element in a ghost set. */
+	struct list_elem list_elem; /* Element in the set's FIFO or free list. */
+};
+
+/* A bounded FIFO of ghosts with O(1) lookup.  Ghosts come from a
+ * pool allocated up front, since they are added with the frame
+ * table lock held. */
+struct ghost_set {
+	struct hash hash;
+	struct list fifo;
+	size_t cnt;
+	struct list free;           /* Unused ghosts of the pool. */
+};
+
+static uint64_t
+ghost_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct ghost *g = hash_entry (e, struct ghost, hash_elem);
+	return hash_bytes (&g->pml4, sizeof g->pml4) ^ hash_bytes (&g->va, sizeof g->va);
+}
+
+static bool
+ghost_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct ghost *a = hash_entry (a_, struct ghost, hash_elem);
+	const struct ghost *b = hash_entry (b_, struct ghost, hash_elem);
+	return a->pml4 != b->pml4 ? a->pml4 < b->pml4 : a->va < b->va;
+}
+
+/* Initializes GS with a pool of one ghost per user page, more than
+ * either policy keeps.  Without memory for the pool, GS remembers
+ * nothing. */
+static void
+ghost_init (struct ghost_set *gs) {
+	size_t cnt = palloc_user_pages (), i;
+	struct ghost *pool = malloc (cnt * sizeof *pool);
+
+	hash_init (&gs->hash, ghost_hash, ghost_less, NULL);
+	list_init (&gs->fifo);
+	gs->cnt = 0;
+	list_init (&gs->free);
+	for (i = 0; pool != NULL && i < cnt; i++)
+		list_push_back (&gs->free, &pool[i].list_elem);
+}
+
+/* Returns G, which is no longer in GS's FIFO, to GS's pool. */
+static void
+ghost_release (struct ghost_set *gs, struct ghost *g) {
+	hash_delete (&gs->hash, &g->hash_elem);
+	gs->cnt--;
+	list_push_back (&gs->free, &g->list_elem);
+}
+
+/* Forgets the oldest ghost in GS. */
+static void
+ghost_drop_oldest (struct ghost_set *gs) {
+	ghost_release (gs, list_entry (list_pop_front (&gs->fifo),
+				struct ghost, list_elem));
+}
+
+/* Remembers F's page in GS, forgetting the oldest ghost if the
+ * pool has run out. */
+static void
+ghost_add (struct ghost_set *gs, struct frame *f) {
+	struct ghost *g;
+
+	if (list_empty (&gs->free)) {
+		if (gs->cnt == 0)
+			return;
+		ghost_drop_oldest (gs);
+	}
+	g = list_entry (list_pop_front (&gs->free), struct ghost, list_elem);
+	g->pml4 = f->page->pml4;
+	g->va = f->page->va;
+	if (hash_insert (&gs->hash, &g->hash_elem) != NULL) {
+		list_push_back (&gs->free, &g->list_elem);
+		return;
+	}
+	list_push_back (&gs->fifo, &g->list_elem);
+	gs->cnt++;
+}
+
+/* Forgets every ghost in GS that belongs to PML4. */
+static void
+ghost_forget (struct ghost_set *gs, const uint64_t *pml4) {
+	struct list_elem *e = list_begin (&gs->fifo);
+
+	while (e != list_end (&gs->fifo)) {
+		struct ghost *g = list_entry (e, struct ghost, list_elem);
+
+		e = list_next (e);
+		if (g->pml4 == pml4) {
+			list_remove (&g->list_elem);
+			ghost_release (gs, g);
+		}
+	}
+}
+
+/* If GS remembers F's page, forgets it and returns true. */
+static bool
+ghost_take (struct ghost_set *gs, struct frame *f) {
+	struct ghost key, *g;
+	struct hash_elem *e;
+
+	key.pml4 = f->page->pml4;
+	key.va = f->page->va;
+	e = hash_find (&gs->hash, &key.hash_elem);
+	if (e == NULL)
+		return false;
+	g = hash_entry (e, struct ghost, hash_elem);
+	list_remove (&g->list_elem);
+	ghost_release (gs, g);
+	return true;
+}
+
+/* ------------------------------------------------------------------ */
+/* CLOCK. */
+
+static struct ring clock_ring;
+static struct {
+	unsigned long long scans, second_chances;
+} clock_stats;
+
+static void
+clock_init (void) {
+	ring_init (&clock_ring);
+}
+
+static void
+clock_on_map (struct frame *f) {
+	f->policy_flags = 0;
+	ring_insert (&clock_ring, f);
+}
+
+static struct frame *
+clock_pick_victim (void) {
+	return ring_second_chance (&clock_ring, &clock_stats.scans,
+			&clock_stats.second_chances);
+}
+
+static void
+clock_on_unmap (struct frame *f, bool evicted UNUSED) {
+	ring_remove (&clock_ring, f);
+}
+
+static void
+clock_print_stats (void) {
+	printf ("Paging: clock examined %llu frames, %llu second chances\n",
+			clock_stats.scans, clock_stats.second_chances);
+}
+
+const struct evict_policy evict_clock = {
+	.name = "clock",
+	.init = clock_init,
+	.on_map = clock_on_map,
+	.on_access = mark_referenced,
+	.pick_victim = clock_pick_victim,
+	.on_unmap = clock_on_unmap,
+	.print_stats = clock_print_stats,
+};
+
+/* ------------------------------------------------------------------ */
+/* 2Q. */
+
+static struct list a1in;            /* FIFO of pages used once. */
+static size_t a1in_cnt;
+static struct ring am;              /* Hot pages. */
+static struct ghost_set a1out;      /* Pages recently evicted from A1in. */
+static struct {
+	unsigned long long a1in_evictions, am_evictions, ghost_hits;
+	unsigned long long scans, second_chances;
+} twoq_stats;
+
+static void
+twoq_init (void) {
+	list_init (&a1in);
+	a1in_cnt = 0;
+	ring_init (&am);
+	ghost_init (&a1out);
+}
+
+static void
+twoq_on_map (struct frame *f) {
+	if (ghost_take (&a1out, f)) {
+		/* Used again soon after leaving A1in: a hot page. */
+		f->policy_flags = F_HOT;
+		ring_insert (&am, f);
+		twoq_stats.ghost_hits++;
+	} else {
+		f->policy_flags = 0;
+		list_push_back (&a1in, &f->policy_elem);
+		a1in_cnt++;
+	}
+}
+
+static struct frame *
+twoq_pick_victim (void) {
+	/* A1in gets a quarter of resident frames. */
+	size_t kin = (a1in_cnt + am.cnt) / 4;
+
+	if (a1in_cnt > 0 && (a1in_cnt > kin || am.cnt == 0)) {
+		twoq_stats.a1in_evictions++;
+		return list_entry (list_front (&a1in), struct frame, policy_elem);
+	}
+	if (am.cnt > 0) {
+		twoq_stats.am_evictions++;
+		return ring_second_chance (&am, &twoq_stats.scans,
+				&twoq_stats.second_chances);
+	}
+	return NULL;
+}
+
+static void
+twoq_on_unmap (struct frame *f, bool evicted) {
+	if (f->policy_flags & F_HOT)
+		ring_remove (&am, f);
+	else {
+		list_remove (&f->policy_elem);
+		a1in_cnt--;
+		if (evicted) {
+			/* A1out remembers half as many pages as are resident. */
+			ghost_add (&a1out, f);
+			while (a1out.cnt > 1 && a1out.cnt > (a1in_cnt + am.cnt) / 2)
+				ghost_drop_oldest (&a1out);
+		}
+	}
+}
+
+static void
+twoq_forget (const uint64_t *pml4) {
+	ghost_forget (&a1out, pml4);
+}
+
+static void
+twoq_print_stats (void) {
+	printf ("Paging: 2q evicted %llu from A1in, %llu from Am, "
+			"%llu ghost hits\n", twoq_stats.a1in_evictions,
+			twoq_stats.am_evictions, twoq_stats.ghost_hits);
+	printf ("Paging: 2q Am examined %llu frames, %llu second chances\n",
+			twoq_stats.scans, twoq_stats.second_chances);
+}
+
+const struct evict_policy evict_2q = {
+	.name = "2q",
+	.init = twoq_init,
+	.on_map = twoq_on_map,
+	.on_access = mark_referenced,
+	.pick_victim = twoq_pick_victim,
+	.on_unmap = twoq_on_unmap,
+	.forget = twoq_forget,
+	.print_stats = twoq_print_stats,
+};
+
+/* ------------------------------------------------------------------ */
+/* CLOCK-Pro. */
+
+static struct list cp_list;         /* All resident pages, clock order. */
+static struct list_elem *hand_cold; /* Next page for the cold hand. */
+static struct list_elem *hand_hot;  /* Next page for the hot hand. */
+static size_t cp_hot_cnt, cp_cold_cnt;
+static size_t cold_target;          /* Adaptive target for cold pages. */
+static struct ghost_set cp_test;    /* Evicted cold pages in test period. */
+static struct {
+	unsigned long long promotions, demotions, ghost_hits, expired_tests;
+	unsigned long long scans;
+} cp_stats;
+
+static struct list_elem *
+cp_next (struct list_elem *e) {
+	e = list_next (e);
+	return e != list_end (&cp_list) ? e : list_begin (&cp_list);
+}
+
+static void
+clockpro_init (void) {
+	list_init (&cp_list);
+	hand_cold = hand_hot = NULL;
+	cp_hot_cnt = cp_cold_cnt = 0;
+	cold_target = 1;
+	ghost_init (&cp_test);
+}
+
+/* Raises (DELTA > 0) or lowers the cold target, keeping it between
+ * one page and all resident pages. */
+static void
+cp_adjust_target (int delta) {
+	size_t resident = cp_hot_cnt + cp_cold_cnt;
+
+	if (delta > 0 && cold_target < resident)
+		cold_target++;
+	else if (delta < 0 && cold_target > 1)
+		cold_target--;
+}
+
+/* Runs the hot hand until one hot page is demoted to cold. */
+static void
+cp_run_hand_hot (void) {
+	size_t budget = 2 * (cp_hot_cnt + cp_cold_cnt);
+
+	while (hand_hot != NULL && budget-- > 0) {
+		struct frame *f = list_entry (hand_hot, struct frame, policy_elem);
+		hand_hot = cp_next (hand_hot);
+		cp_stats.scans++;
+
+		if (f->policy_flags & F_HOT) {
+			if (!referenced (f)) {
+				f->policy_flags &= ~F_HOT;
+				cp_hot_cnt--;
+				cp_cold_cnt++;
+				cp_stats.demotions++;
+				return;
+			}
+		} else if (f->policy_flags & F_TEST) {
+			/* The test period ran out without a reuse: cold pages
+			 * are not earning their keep. */
+			f->policy_flags &= ~F_TEST;
+			cp_adjust_target (-1);
+			cp_stats.expired_tests++;
+		}
+	}
+}
+
+/* Demotes hot pages while there are more than the target allows. */
+static void
+cp_balance (void) {
+	size_t resident = cp_hot_cnt + cp_cold_cnt;
+
+	while (cp_hot_cnt > 0 && cp_hot_cnt + cold_target > resident) {
+		size_t before = cp_hot_cnt;
+		cp_run_hand_hot ();
+		if (cp_hot_cnt == before)
+			break;
+	}
+}
+
+static void
+clockpro_on_map (struct frame *f) {
+	if (ghost_take (&cp_test, f)) {
+		/* Faulted back in during its test period: the cold set is
+		 * too small to hold this working set. */
+		f->policy_flags = F_HOT;
+		cp_hot_cnt++;
+		cp_adjust_target (+1);
+		cp_stats.ghost_hits++;
+	} else {
+		f->policy_flags = F_TEST;
+		cp_cold_cnt++;
+	}
+
+	if (hand_cold == NULL) {
+		list_push_back (&cp_list, &f->policy_elem);
+		hand_cold = hand_hot = &f->policy_elem;
+	} else
+		list_insert (hand_cold, &f->policy_elem);
+	cp_balance ();
+}
+
+static struct frame *
+clockpro_pick_victim (void) {
+	size_t budget = 2 * (cp_hot_cnt + cp_cold_cnt);
+
+	while (hand_cold != NULL) {
+		struct frame *f = list_entry (hand_cold, struct frame, policy_elem);
+		hand_cold = cp_next (hand_cold);
+		cp_stats.scans++;
+
+		if (budget-- == 0)
+			return f;
+		if (f->policy_flags & F_HOT)
+			continue;
+		if (!referenced (f))
+			return f;
+		if (f->policy_flags & F_TEST) {
+			/* Reused within its test period: promote. */
+			f->policy_flags = F_HOT;
+			cp_cold_cnt--;
+			cp_hot_cnt++;
+			cp_stats.promotions++;
+			cp_balance ();
+		} else
+			f->policy_flags |= F_TEST;
+	}
+	return NULL;
+}
+
+static void
+clockpro_on_unmap (struct frame *f, bool evicted) {
+	struct list_elem *e = &f->policy_elem;
+
+	if (hand_cold == e)
+		hand_cold = cp_next (e);
+	if (hand_hot == e)
+		hand_hot = cp_next (e);
+	if (hand_cold == e)
+		hand_cold = hand_hot = NULL;
+	list_remove (e);
+
+	if (f->policy_flags & F_HOT)
+		cp_hot_cnt--;
+	else {
+		cp_cold_cnt--;
+		if (evicted && (f->policy_flags & F_TEST)) {
+			/* Keep testing it while it is out, for at most as many
+			 * pages as are resident. */
+			ghost_add (&cp_test, f);
+			while (cp_test.cnt > 1 && cp_test.cnt > cp_hot_cnt + cp_cold_cnt) {
+				ghost_drop_oldest (&cp_test);
+				cp_adjust_target (-1);
+				cp_stats.expired_tests++;
+			}
+		}
+	}
+}
+
+static void
+clockpro_forget (const uint64_t *pml4) {
+	ghost_forget (&cp_test, pml4);
+}
+
+static void
+clockpro_print_stats (void) {
+	printf ("Paging: clockpro %zu hot, %zu cold, cold target %zu\n",
+			cp_hot_cnt, cp_cold_cnt, cold_target);
+	printf ("Paging: clockpro %llu promotions, %llu demotions, "
+			"%llu ghost hits, %llu expired tests, %llu examined\n",
+			cp_stats.promotions, cp_stats.demotions, cp_stats.ghost_hits,
+			cp_stats.expired_tests, cp_stats.scans);
+}
+
+const struct evict_policy evict_clockpro = {
+	.name = "clockpro",
+	.init = clockpro_init,
+	.on_map = clockpro_on_map,
+	.on_access = mark_referenced,
+	.pick_victim = clockpro_pick_victim,
+	.on_unmap = clockpro_on_unmap,
+	.forget = clockpro_forget,
+	.print_stats = clockpro_print_stats,
+};
@@ -3,10 +3,26 @@
 #include "vm/vm.h"
 //vm 추가 include
 #include "threads/mmu.h"
+#include "devices/timer.h"
+#include "filesys/inode.h"
+#include "vm/vma.h"
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
+
+/* Cache for struct mmap_aux. */
+static struct slab_cache *mmap_aux_slab;
+
+/* File mapping statistics. */
+static struct {
+	unsigned long long unmaps;          /* munmap() calls. */
+	int64_t unmap_ticks;                /* Timer ticks spent in them. */
+	int64_t unmap_max;                  /* Longest of them. */
+	unsigned long long unmap_writes;    /* Dirty pages written by them. */
+	unsigned long long writes;          /* All dirty pages written back. */
+} mmap_stats;
 
-//vm추가 lock
-extern struct lock filesys_lock;
-extern struct lock lru_lock;
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -23,127 +39,444 @@ static const struct page_operations file_ops = {
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	mmap_aux_slab = slab_cache_create ("mmap_aux", sizeof (struct mmap_aux),
+			NULL);
+	ASSERT (mmap_aux_slab != NULL);
 }
 
 /* Initialize the file backed page */
 bool
 file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+	/* The uninit page shares storage with file_page: fetch the
+	 * mapping information before overwriting it. */
+	struct mmap_aux *aux = page->uninit.aux;
+
 	/* Set up the handler */
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+	file_page->page = page;
+	file_page->file = aux->load.file;
+	file_page->ofs = aux->load.ofs;
+	file_page->page_read_bytes = aux->load.page_read_bytes;
+	file_page->page_zero_bytes = aux->load.page_zero_bytes;
+	return true;
+}
+
+/* Writes PAGE, which is in FRAME, back to its file if the process
+ * modified it.  The file system's inode layer serializes sector
+ * I/O, and a mapping never grows its file, so this is done without
+ * filesys_lock; the evictor may be running inside a system call
+ * that already holds it. */
+static void
+file_backed_write_back (struct page *page, struct frame *frame) {
+	struct file_page *file_page = &page->file;
+
+	if (pml4_is_dirty (page->pml4, page->va)) {
+		file_backed_write_page (page, frame->kva);
+		pml4_set_dirty (page->pml4, page->va, false);
+	}
+}
+
+/* Writes the contents of PAGE, at KVA, to its part of its file. */
+void
+file_backed_write_page (struct page *page, const void *kva) {
+	struct file_page *file_page = &page->file;
+
+	/* KVA is the frame the page cache holds for the page: a plain
+	 * write would try to update it. */
+	inode_write_back_at (file_get_inode (file_page->file), kva,
+			file_page->page_read_bytes, file_page->ofs);
+	mmap_stats.writes++;
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
 	struct file_page *file_page UNUSED = &page->file;
+	off_t read = file_read_at (file_page->file, kva,
+			file_page->page_read_bytes, file_page->ofs);
+
+	memset ((uint8_t *) kva + read, 0, PGSIZE - read);
+	return read == (off_t) file_page->page_read_bytes;
 }
 
 /* Swap out the page by writeback contents to the file. */
 static bool
 file_backed_swap_out (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+	file_backed_write_back (page, page->frame);
+	return true;
+}
+
+/* Releases the frame of PAGE, writing it back first if it is
+ * dirty.  PAGE stays in the mapping and is read back in on its next
+ * fault. */
+void
+file_backed_drop (struct page *page) {
+	struct frame *frame = vm_take_frame (page);
+
+	if (frame != NULL) {
+		file_backed_write_back (page, frame);
+		vm_free_frame (frame);
+	}
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+	file_backed_drop (page);
+
+	/* A text page has a file of its own. */
+	if (page->vma == NULL)
+		file_close (file_page->file);
 }
 
 
 //vm mmap 추가 함수
 static bool
 lazy_mmap(struct page *page, void *aux){
-	bool success = true;
-	struct mmap_aux *info = (struct mmap*)aux;
-	list_push_back(&(thread_current()->mmap_list), &(page->file.file_elem));
-	
-	//lock extern 방식으로 정의를 어디서 해야할 지 아직 모름...
-	lock_acquire(&filesys_lock);
-	off_t read = file_read_at(info->file, page->va, (off_t)info->page_read_bytes, info->ofs);
-	lock_release(&filesys_lock);
-	if(read != (off_t)info->page_read_bytes){
-		vm_dealloc_page(page);
-		success = false;
+	/* file_backed_initializer() already copied AUX into PAGE. */
+	bool success = vm_lazy_read (&((struct mmap_aux *) aux)->load,
+			page->frame->kva);
+	slab_free (mmap_aux_slab, aux);
+	return success;
+}
+
+
+/* Turns PAGE, an untouched page of a file mapping, into a file page
+ * without reading it in, for it to share a frame that the page cache
+ * holds for the same part of the file. */
+void
+file_backed_adopt (struct page *page) {
+	struct mmap_aux *aux = page->uninit.aux;
+
+	file_backed_initializer (page, page->uninit.type, NULL);
+	slab_free (mmap_aux_slab, aux);
+}
+
+/* Frees AUX, the mmap_aux of a page of a file mapping that was
+ * never touched.  Its file belongs to the page's vma, if any. */
+void
+file_backed_free_aux (struct mmap_aux *aux) {
+	slab_free (mmap_aux_slab, aux);
+}
+
+/* Adds to the current process the page at VA, which VMA covers but
+ * no struct page stands for yet, set up to load from VMA's file on
+ * first touch.  Returns the page, or a null pointer if out of
+ * memory. */
+struct page *
+file_backed_materialize (struct vma *vma, void *va) {
+	size_t ofs = (uint8_t *) va - vma->start;
+	size_t read_bytes = ofs < vma->read_bytes ? vma->read_bytes - ofs : 0;
+	struct mmap_aux *aux = slab_alloc (mmap_aux_slab);
+	struct page *page;
+
+	ASSERT (pg_ofs (va) == 0);
+	if (aux == NULL)
+		return NULL;
+	vm_lazy_init (&aux->load, vma->file, vma->ofs + ofs,
+			read_bytes < PGSIZE ? read_bytes : PGSIZE);
+	aux->load.fault_around = vma->fault_around;
+	if (!vm_alloc_page_with_initializer (VM_FILE | VM_LAZY_FILE, va,
+				vma->writable, lazy_mmap, aux)) {
+		slab_free (mmap_aux_slab, aux);
+		return NULL;
 	}
-	else{
-		memset((page->va) + info->page_read_bytes, 0, info->page_read_bytes);
-		page->file.page = page;
-		page->file.file = info->file;
-		page->file.start = info->start;
-		page->file.length = info->length;
-		page->file.ofs = info->ofs;
-		page->file.page_read_bytes = info->page_read_bytes;
-		page->file.page_zero_bytes = info->page_zero_bytes;
+	page = spt_find_page (&thread_current ()->spt, va);
+	page->advice = vma->advice;
+	vma_add_page (vma, page);
+	return page;
+}
+
+/* Adds to the current process a read-only page at UPAGE that loads
+ * the page of FILE at OFS on first touch.  It is a file page outside
+ * any vma, so that every process running the same executable shares
+ * one frame for it through the page cache.  The page takes over
+ * FILE.  Returns false if out of memory, in which case the caller
+ * still owns FILE. */
+bool
+file_backed_alloc_text (void *upage, struct file *file, off_t ofs) {
+	struct mmap_aux *aux = slab_alloc (mmap_aux_slab);
+
+	if (aux == NULL)
+		return false;
+	vm_lazy_init (&aux->load, file, ofs, PGSIZE);
+	if (!vm_alloc_page_with_initializer (VM_FILE | VM_LAZY_FILE, upage,
+				false, lazy_mmap, aux)) {
+		slab_free (mmap_aux_slab, aux);
+		return false;
 	}
-	free(aux);
-	pml4_set_dirty(thread_current()->pml4, page->va, false);
-	return success;
+	return true;
 }
 
+/* Adds to the current process a copy of SRC, an untouched page that
+ * file_backed_alloc_text() created in another process, with its own
+ * handle on the file.  Returns false if out of memory. */
+bool
+file_backed_copy_text (struct page *src) {
+	struct mmap_aux *aux = slab_alloc (mmap_aux_slab);
 
-/* Do the mmap */
+	ASSERT (src->vma == NULL);
+	if (aux == NULL)
+		return false;
+	memcpy (aux, src->uninit.aux, sizeof *aux);
+	aux->load.file = file_duplicate (aux->load.file);
+	if (aux->load.file == NULL
+			|| !vm_alloc_page_with_initializer (src->uninit.type, src->va,
+				src->writable, src->uninit.init, aux)) {
+		file_close (aux->load.file);
+		slab_free (mmap_aux_slab, aux);
+		return false;
+	}
+	return true;
+}
+
+/* Do the mmap
+ *
+ * The mapping becomes a single vma; its pages are created as they
+ * are used, so mapping costs the same whatever the length.  A
+ * running executable cannot be mapped writable: its text pages
+ * share their frames with the page cache, so stores through the
+ * mapping would change the code of every process running it. */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
 			//vm 추가사항
-	struct file *reopen_file = file_reopen(file);
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct file *reopen_file;
+	struct vma *vma;
+	off_t flen;
+
+	if (writable && inode_denies_write (file_get_inode (file)))
+		return NULL;
+	reopen_file = file_reopen(file);
 	if(reopen_file == NULL)return NULL;
-	//int i = 0;
-	size_t read_bytes = length;
-	size_t zero_bytes = PGSIZE - length % PGSIZE;
-	off_t dynamic_ofs = offset;
-	void *upage = addr;
-	while(read_bytes > 0 || zero_bytes > 0){
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		struct mmap_aux * aux = (struct mmap_aux *)malloc(sizeof(struct mmap_aux));
-		aux->file = reopen_file;
-		aux->start = addr;
-		aux->length = length;
-		aux->ofs = dynamic_ofs;
-		aux->page_read_bytes = page_read_bytes;
-		aux->page_zero_bytes = page_zero_bytes;
-		if(!vm_alloc_page_with_initializer(VM_FILE, upage, writable, lazy_mmap, (void*)aux)){
-			file_close(reopen_file);
-			return NULL;
-		}
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
-		dynamic_ofs += PGSIZE;
-		//i++;
+	vma = vma_alloc ();
+	if (vma == NULL) {
+		file_close (reopen_file);
+		return NULL;
+	}
+	/* Bytes of the mapping backed by the file; the rest of the
+	 * last page, and any pages past the end of the file, read as
+	 * zeros. */
+	flen = file_length (reopen_file);
+	vma->start = vma->map_start = addr;
+	vma->end = (uint8_t *) addr + ROUND_UP (length, PGSIZE);
+	vma->file = reopen_file;
+	vma->ofs = offset;
+	vma->read_bytes = flen > offset ? (size_t) (flen - offset) : 0;
+	if (vma->read_bytes > length)
+		vma->read_bytes = length;
+	vma->writable = writable;
+	vma->advice = MADV_NORMAL;
+	vma->fault_around = vm_fault_around;
+	if (!vma_insert (spt, vma)) {
+		file_close (reopen_file);
+		vma_free (vma);
+		return NULL;
 	}
 	return addr;
 }
 
-/* Do the munmap */
+/* Do the munmap
+ *
+ * Removes the mapping that ADDR is part of, every vma that
+ * madvise() has split it into, and the pages created in them. */
 void
 do_munmap (void *addr) {
-	struct thread *cur = thread_current();
-	struct page *pg = spt_find_page(&(cur->spt), addr);
-	size_t length = pg->file.length;
-	struct file *file = pg->file.file;
-
-	//void *tmp;
-	size_t pivot = 0;
-	while(pivot < length){
-		pg = spt_find_page(&(cur->spt), addr);
-		if(pml4_is_dirty(cur->pml4, addr)){
-			lock_acquire(&filesys_lock);
-			file_write_at(file, addr, pg->file.page_read_bytes, pg->file.ofs);
-			lock_release(&filesys_lock);
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma = vma_find (spt, addr);
+	uint8_t *map_start;
+	unsigned long long writes = mmap_stats.writes;
+	int64_t start = timer_ticks (), ticks;
+
+	if (vma == NULL)
+		return;
+	map_start = vma->map_start;
+	vma = vma_find (spt, map_start);
+	while (vma != NULL && vma->map_start == map_start) {
+		uint8_t *end = vma->end;
+
+		/* Destroying each page writes it back if it is dirty. */
+		while (!list_empty (&vma->pages)) {
+			struct page *pg = list_entry (list_pop_front (&vma->pages),
+					struct page, vma_elem);
+			spt_remove_page (spt, pg);
 		}
+		vma_remove (spt, vma);
+		file_close (vma->file);
+		vma_free (vma);
+		vma = vma_find (spt, end);
+	}
 
-		hash_delete(&(cur->spt), &(pg->page_elem));
-		spt_remove_page(&cur->spt, pg);
-		vm_dealloc_page(pg);
+	ticks = timer_elapsed (start);
+	mmap_stats.unmaps++;
+	mmap_stats.unmap_ticks += ticks;
+	if (ticks > mmap_stats.unmap_max)
+		mmap_stats.unmap_max = ticks;
+	mmap_stats.unmap_writes += mmap_stats.writes - writes;
+}
 
-		addr += PGSIZE;
-		pivot += PGSIZE;
+/* Makes ADDR, which is page-aligned, a boundary between vmas of
+ * SPT, splitting the vma that covers it.  The new vma, from ADDR
+ * on, gets a file of its own and the pages in its range.  Returns
+ * false if out of memory. */
+static bool
+vma_split (struct supplemental_page_table *spt, uint8_t *addr) {
+	struct vma *vma = vma_find (spt, addr), *tail;
+	size_t ofs;
+	struct list_elem *e;
+
+	if (vma == NULL || vma->start == addr)
+		return true;
+	tail = vma_alloc ();
+	if (tail == NULL)
+		return false;
+	ofs = addr - vma->start;
+	tail->file = file_reopen (vma->file);
+	if (tail->file == NULL) {
+		vma_free (tail);
+		return false;
+	}
+	tail->start = addr;
+	tail->end = vma->end;
+	tail->map_start = vma->map_start;
+	tail->ofs = vma->ofs + ofs;
+	tail->read_bytes = vma->read_bytes > ofs ? vma->read_bytes - ofs : 0;
+	tail->writable = vma->writable;
+	tail->advice = vma->advice;
+	tail->fault_around = vma->fault_around;
+
+	vma->end = addr;
+	if (vma->read_bytes > ofs)
+		vma->read_bytes = ofs;
+	if (!vma_insert (spt, tail)) {
+		vma->end = tail->end;
+		vma->read_bytes += tail->read_bytes;
+		file_close (tail->file);
+		vma_free (tail);
+		return false;
 	}
-	file_close(file);
+
+	/* Move the pages past ADDR, pointing them at the new file. */
+	for (e = list_begin (&vma->pages); e != list_end (&vma->pages); ) {
+		struct page *pg = list_entry (e, struct page, vma_elem);
+
+		e = list_next (e);
+		if ((uint8_t *) pg->va < addr)
+			continue;
+		list_remove (&pg->vma_elem);
+		list_push_back (&tail->pages, &pg->vma_elem);
+		pg->vma = tail;
+		if (VM_TYPE (pg->operations->type) == VM_UNINIT)
+			((struct mmap_aux *) pg->uninit.aux)->load.file = tail->file;
+		else
+			pg->file.file = tail->file;
+	}
+	return true;
+}
+
+/* Applies ADVICE to the LENGTH bytes of file mappings starting at
+ * ADDR, which is page-aligned.  MADV_NORMAL, MADV_RANDOM and
+ * MADV_SEQUENTIAL are kept on the vmas of the range, which are split
+ * to fit it, and steer how much is read on their faults.
+ * MADV_WILLNEED reads the pages in now, as far as free memory
+ * allows, and MADV_DONTNEED writes the resident ones back and
+ * releases them.  Returns 0 if successful, -1 if part of the range
+ * is not mapped from a file or memory runs out. */
+int
+do_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = addr;
+	uint8_t *end = start + ROUND_UP (length, PGSIZE);
+	uint8_t *va;
+	struct vma *vma;
+	struct list_elem *e;
+
+	for (va = start; va < end; va = vma->end)
+		if ((vma = vma_find (spt, va)) == NULL)
+			return -1;
+
+	switch (advice) {
+		case MADV_WILLNEED:
+			for (va = start; va < end; va += PGSIZE) {
+				struct page *pg = spt_get_page (spt, va);
+
+				/* Stop once memory runs short: reading ahead must
+				 * not push out pages in use. */
+				if (pg == NULL
+						|| !vm_prefetch (pg, (size_t) (end - va) / PGSIZE))
+					break;
+			}
+			break;
+		case MADV_DONTNEED:
+			for (va = start; va < end; va = vma->end) {
+				vma = vma_find (spt, va);
+				for (e = list_begin (&vma->pages); e != list_end (&vma->pages);
+						e = list_next (e)) {
+					struct page *pg = list_entry (e, struct page, vma_elem);
+					if ((uint8_t *) pg->va >= start && (uint8_t *) pg->va < end)
+						vm_drop_page (pg);
+				}
+			}
+			break;
+		default:
+			if (!vma_split (spt, start) || !vma_split (spt, end))
+				return -1;
+			for (va = start; va < end; va = vma->end) {
+				vma = vma_find (spt, va);
+				vma->advice = advice;
+				vma->fault_around = vm_advice_fault_around (advice);
+				for (e = list_begin (&vma->pages); e != list_end (&vma->pages);
+						e = list_next (e))
+					vm_set_advice (list_entry (e, struct page, vma_elem), advice);
+			}
+			break;
+	}
+	return 0;
+}
+
+/* Writes the dirty pages among the LENGTH bytes of file mappings
+ * starting at ADDR, which is page-aligned, back to their files.
+ * Returns 0 if successful, -1 if part of the range is not mapped
+ * from a file. */
+int
+do_msync (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = addr;
+	uint8_t *end = start + ROUND_UP (length, PGSIZE);
+	uint8_t *va;
+	struct vma *vma;
+	struct list_elem *e;
+
+	for (va = start; va < end; va = vma->end)
+		if ((vma = vma_find (spt, va)) == NULL)
+			return -1;
+
+	for (va = start; va < end; va = vma->end) {
+		vma = vma_find (spt, va);
+		for (e = list_begin (&vma->pages); e != list_end (&vma->pages);
+				e = list_next (e)) {
+			struct page *pg = list_entry (e, struct page, vma_elem);
+			if ((uint8_t *) pg->va >= start && (uint8_t *) pg->va < end)
+				vm_sync_page (pg);
+		}
+	}
+	return 0;
+}
+
+/* Prints file mapping statistics. */
+void
+file_backed_print_stats (void) {
+	if (mmap_stats.unmaps > 0)
+		printf ("Mmap: %llu unmaps in %lld ticks (longest %lld), "
+				"writing %llu dirty pages\n", mmap_stats.unmaps,
+				mmap_stats.unmap_ticks, mmap_stats.unmap_max,
+				mmap_stats.unmap_writes);
+	if (mmap_stats.writes > 0)
+		printf ("Mmap: %llu dirty pages written back in all\n",
+				mmap_stats.writes);
 }
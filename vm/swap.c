@@ -0,0 +1,237 @@
+/* swap.c: Swap slot allocation and swap disk I/O.
+ *
+ * The swap disk (hd1:1) is divided into page-sized slots, tracked
+ * by a bitmap.  Anonymous pages are written out in clusters of up
+ * to SWAP_CLUSTER pages, each cluster to a run of consecutive slots
+ * with a single multi-sector transfer, and read back the same way,
+ * so that a burst of evictions or faults costs one disk command
+ * instead of one per sector.  Pages that zswap (vm/zswap.c) can
+ * keep compressed in memory skip the disk altogether.
+ *
+ * Slots are handed out next-fit, from a rotor that follows the last
+ * allocation, so clusters evicted one after another land next to
+ * each other and free space is reused in order.
+ *
+ * A page shared copy-on-write across fork is swapped out once for
+ * all its sharers, so a slot may have more than one owner.  Each
+ * slot counts its owners and is released when the last one frees
+ * it. */
+
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/disk.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+/* Sectors per swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+static struct disk *swap_disk;
+static struct bitmap *swap_map;     /* Set bits are slots in use. */
+static uint16_t *swap_refs;         /* Owners of each slot in use. */
+static size_t swap_rotor;           /* Where the next search starts. */
+static struct lock swap_lock;       /* Protects the above. */
+
+/* Swap statistics. */
+static struct {
+	size_t in_use;                  /* Slots currently allocated. */
+	size_t peak;                    /* Maximum of IN_USE. */
+	unsigned long long pages_out;   /* Pages written. */
+	unsigned long long writes;      /* Write transfers. */
+	unsigned long long pages_in;    /* Pages read. */
+	unsigned long long reads;       /* Read transfers. */
+	int64_t io_ticks;               /* Timer ticks spent in transfers. */
+} swap_stats;
+
+/* Sets up swap on disk D, which may be null if there is no swap
+ * disk, in which case every allocation fails. */
+void
+swap_init (struct disk *d) {
+	lock_init (&swap_lock);
+	swap_disk = d;
+	if (d == NULL || disk_size (d) < SECTORS_PER_SLOT)
+		return;
+	swap_map = bitmap_create (disk_size (d) / SECTORS_PER_SLOT);
+	swap_refs = calloc (bitmap_size (swap_map), sizeof *swap_refs);
+	if (swap_map == NULL || swap_refs == NULL)
+		PANIC ("swap: cannot allocate slot bitmap");
+}
+
+/* Allocates CNT consecutive slots and returns the first one, or
+ * SWAP_SLOT_NONE if no run that long is free. */
+size_t
+swap_alloc (size_t cnt) {
+	size_t slot;
+
+	if (swap_map == NULL)
+		return SWAP_SLOT_NONE;
+
+	lock_acquire (&swap_lock);
+	slot = bitmap_scan_and_flip (swap_map, swap_rotor, cnt, false);
+	if (slot == BITMAP_ERROR)
+		slot = bitmap_scan_and_flip (swap_map, 0, cnt, false);
+	if (slot != BITMAP_ERROR) {
+		size_t i;
+		for (i = 0; i < cnt; i++)
+			swap_refs[slot + i] = 1;
+		swap_rotor = slot + cnt;
+		swap_stats.in_use += cnt;
+		if (swap_stats.in_use > swap_stats.peak)
+			swap_stats.peak = swap_stats.in_use;
+	}
+	lock_release (&swap_lock);
+
+	return slot != BITMAP_ERROR ? slot : SWAP_SLOT_NONE;
+}
+
+/* Adds an owner to SLOT, which must be in use. */
+void
+swap_dup (size_t slot) {
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_map, slot));
+	ASSERT (swap_refs[slot] < UINT16_MAX);
+	swap_refs[slot]++;
+	lock_release (&swap_lock);
+}
+
+/* Drops an owner from each of the CNT slots starting at SLOT,
+ * releasing the slots no one owns any more. */
+void
+swap_free (size_t slot, size_t cnt) {
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		bool last;
+
+		lock_acquire (&swap_lock);
+		ASSERT (bitmap_test (swap_map, slot + i));
+		ASSERT (swap_refs[slot + i] > 0);
+		last = --swap_refs[slot + i] == 0;
+		lock_release (&swap_lock);
+		if (!last)
+			continue;
+
+		/* Drop the compressed copy before the slot can be reused. */
+		zswap_invalidate (slot + i);
+		lock_acquire (&swap_lock);
+		bitmap_reset (swap_map, slot + i);
+		swap_stats.in_use--;
+		lock_release (&swap_lock);
+	}
+}
+
+/* Reads the CNT slots starting at SLOT, slot I into the page at
+ * KVAS[I].  Pages held by zswap are copied from there; each run of
+ * the rest is read from disk in one transfer. */
+void
+swap_read (size_t slot, void *const kvas[], size_t cnt) {
+	size_t i = 0;
+
+	while (i < cnt) {
+		size_t run;
+
+		if (zswap_load (slot + i, kvas[i])) {
+			i++;
+			continue;
+		}
+		for (run = 1; i + run < cnt; run++)
+			if (zswap_load (slot + i + run, kvas[i + run]))
+				break;
+		swap_read_disk (slot + i, kvas + i, run);
+		/* The page that ended the run, if any, is already loaded. */
+		i += run + 1;
+	}
+}
+
+/* Writes the pages at KVAS[0...CNT-1] to the CNT slots starting at
+ * SLOT.  Pages zswap accepts stay in memory; each run of the rest
+ * is written to disk in one transfer. */
+void
+swap_write (size_t slot, const void *const kvas[], size_t cnt) {
+	size_t i = 0;
+
+	while (i < cnt) {
+		size_t run;
+
+		if (zswap_store (slot + i, kvas[i])) {
+			i++;
+			continue;
+		}
+		for (run = 1; i + run < cnt; run++)
+			if (zswap_store (slot + i + run, kvas[i + run]))
+				break;
+		swap_write_disk (slot + i, kvas + i, run);
+		i += run + 1;
+	}
+}
+
+/* Reads the CNT slots starting at SLOT from disk, slot I into the
+ * page at KVAS[I], in one transfer. */
+void
+swap_read_disk (size_t slot, void *const kvas[], size_t cnt) {
+	void *sectors[SWAP_CLUSTER * SECTORS_PER_SLOT];
+	int64_t start;
+	size_t i;
+
+	ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+
+	for (i = 0; i < cnt * SECTORS_PER_SLOT; i++)
+		sectors[i] = (uint8_t *) kvas[i / SECTORS_PER_SLOT]
+			+ i % SECTORS_PER_SLOT * DISK_SECTOR_SIZE;
+
+	start = timer_ticks ();
+	disk_read_multiple (swap_disk, slot * SECTORS_PER_SLOT, sectors,
+			cnt * SECTORS_PER_SLOT);
+	swap_stats.io_ticks += timer_elapsed (start);
+	swap_stats.pages_in += cnt;
+	swap_stats.reads++;
+}
+
+/* Writes the pages at KVAS[0...CNT-1] to the CNT slots starting at
+ * SLOT on disk, in one transfer. */
+void
+swap_write_disk (size_t slot, const void *const kvas[], size_t cnt) {
+	const void *sectors[SWAP_CLUSTER * SECTORS_PER_SLOT];
+	int64_t start;
+	size_t i;
+
+	ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+
+	for (i = 0; i < cnt * SECTORS_PER_SLOT; i++)
+		sectors[i] = (const uint8_t *) kvas[i / SECTORS_PER_SLOT]
+			+ i % SECTORS_PER_SLOT * DISK_SECTOR_SIZE;
+
+	start = timer_ticks ();
+	disk_write_multiple (swap_disk, slot * SECTORS_PER_SLOT, sectors,
+			cnt * SECTORS_PER_SLOT);
+	swap_stats.io_ticks += timer_elapsed (start);
+	swap_stats.pages_out += cnt;
+	swap_stats.writes++;
+}
+
+/* Prints swap disk statistics.  Every read beyond one per transfer
+ * is a page that was read ahead. */
+void
+swap_print_stats (void) {
+	unsigned long long pages = swap_stats.pages_in + swap_stats.pages_out;
+
+	zswap_print_stats ();
+	if (swap_map == NULL)
+		return;
+	printf ("Swap: %zu slots, %zu in use, %zu peak\n",
+			bitmap_size (swap_map), swap_stats.in_use, swap_stats.peak);
+	printf ("Swap: %llu pages out in %llu writes, %llu pages in in %llu "
+			"reads (%llu read ahead)\n", swap_stats.pages_out,
+			swap_stats.writes, swap_stats.pages_in, swap_stats.reads,
+			swap_stats.pages_in - swap_stats.reads);
+	if (swap_stats.io_ticks > 0)
+		printf ("Swap: %lld ticks of I/O, %llu kB/s\n", swap_stats.io_ticks,
+				pages * (PGSIZE / 1024) * TIMER_FREQ
+				/ (unsigned long long) swap_stats.io_ticks);
+}
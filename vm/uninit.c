@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "threads/mmu.h"
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -65,4 +66,23 @@ uninit_destroy (struct page *page) {
 	struct uninit_page *uninit UNUSED = &page->uninit;
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
+	/* The zero frame is not the process's to free along with its
+	 * page table. */
+	if (page->zero_mapped)
+		pml4_clear_page (thread_current ()->pml4, page->va);
+
+	/* A page that would have loaded from a file still holds its
+	 * aux.  A file mapping's file belongs to its vma; an executable
+	 * segment page, text or not, has a file of its own. */
+	if (!(uninit->type & VM_LAZY_FILE) || uninit->aux == NULL)
+		return;
+	if (VM_TYPE (uninit->type) == VM_FILE) {
+		if (page->vma == NULL)
+			file_close (((struct mmap_aux *) uninit->aux)->load.file);
+		file_backed_free_aux (uninit->aux);
+	} else {
+		struct load_segment_aux *aux = uninit->aux;
+		file_close (aux->load.file);
+		slab_free (load_aux_slab, aux);
+	}
 }
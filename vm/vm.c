@@ -1,5 +1,7 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <string.h>
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
@@ -9,24 +11,141 @@
 
 //?
 #include "threads/mmu.h"
+#include "devices/timer.h"
+#include "vm/evict.h"
+#include "vm/swap.h"
+#include "vm/vma.h"
+#include "filesys/page_cache.h"
+#include <syscall-nr.h>
 
 extern struct lock filesys_lock;	//syscall.h에 있던 lock을 여기에 가져왔다
 
+struct slab_cache *page_slab;
+struct slab_cache *frame_slab;
+struct slab_cache *load_aux_slab;
+struct slab_cache *vma_slab;
+
+/* Frame table.
+
+   Every frame that holds an evictable user page is on FRAME_TABLE.
+   Which frame to evict is up to the replacement policy (see
+   vm/evict.c), chosen on the kernel command line with -vmpolicy.
+   vm.c reports to the policy every frame that goes on or off the
+   table, and the sampler thread periodically reads and clears the
+   accessed bit of every frame on the table and reports it too, so
+   that policies see references made between evictions.  Accessed
+   bits are read from the page table of the process that owns the
+   frame, which is recorded in the frame along with the owning
+   thread.
+
+   While a frame's contents move to or from backing store the frame
+   is pinned and kept off the table, so no policy picks it.  A
+   thread that needs the page in a pinned frame, to fault it back
+   in or to destroy it, waits on FRAME_COND until the transfer is
+   done.
+
+   FRAME_LOCK protects the table, the policy's state and the links
+   between pages and frames.  It is never held across I/O. */
+static struct list frame_table;
+static size_t frame_cnt;                /* Frames on FRAME_TABLE. */
+static struct lock frame_lock;
+static struct condition frame_cond;     /* A pinned frame was released. */
+
+/* Replacement policy in use. */
+static const struct evict_policy *policy = &evict_clock;
+static const struct evict_policy *const policies[] = {
+	&evict_clock, &evict_2q, &evict_clockpro,
+};
+
+/* Interval at which the sampler thread visits every frame. */
+#define SAMPLE_INTERVAL (TIMER_FREQ / 4)
+
+/* Shared zero frame.  Read faults on anonymous pages that have
+ * never been written map this frame read-only instead of taking a
+ * frame of their own; the first write fault gives the page a
+ * private, zeroed frame.  It comes from the kernel pool, so it is
+ * never on the frame table. */
+static void *zero_frame;
+
+/* Serializes supplemental page table teardown. */
+static struct lock kill_lock;
+
+/* Paging statistics. */
+static struct {
+	unsigned long long faults;          /* Page faults handled. */
+	unsigned long long evictions;       /* Frames evicted. */
+	unsigned long long evict_failures;  /* Victims that could not be written. */
+	unsigned long long swap_ins;        /* Evicted pages read back in. */
+	unsigned long long samples;         /* Sampler passes over the table. */
+	unsigned long long zero_maps;       /* Read faults served by ZERO_FRAME. */
+	unsigned long long zero_copies;     /* Zero pages later written. */
+	size_t peak_frames;                 /* Maximum of FRAME_CNT. */
+	unsigned long long forks;           /* Address spaces copied. */
+	int64_t fork_ticks;                 /* Timer ticks spent copying them. */
+	unsigned long long fork_shares;     /* Frames shared at fork. */
+	unsigned long long cow_copies;      /* Shared frames copied on write. */
+	unsigned long long cow_reuses;      /* Last sharers made writable. */
+	unsigned long long large_maps;      /* Regions mapped with superpages. */
+	unsigned long long large_fallbacks; /* Eligible regions left in 4 kB. */
+	unsigned long long file_loads;      /* Pages loaded from files. */
+	unsigned long long file_reads;      /* Reads that loaded them. */
+	unsigned long long around_faults;   /* Faults that read neighbors. */
+	unsigned long long around_pages;    /* Neighbors loaded by them. */
+	unsigned long long drops;           /* Pages released on advice. */
+	unsigned long long wb_pages;        /* Pages the writeback thread wrote. */
+	unsigned long long wb_passes;       /* Its passes over the table. */
+	unsigned long long sync_pages;      /* Pages msync() wrote. */
+	unsigned long long cache_maps;      /* Faults served by the page cache. */
+} vm_stats;
+
+static void vm_sampler (void *aux);
+static void vm_writeback (void *aux);
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
 vm_init (void) {
 	vm_anon_init ();
 	vm_file_init ();
+	page_slab = slab_cache_create ("page", sizeof (struct page), NULL);
+	frame_slab = slab_cache_create ("frame", sizeof (struct frame), NULL);
+	load_aux_slab = slab_cache_create ("load_aux",
+			sizeof (struct load_segment_aux), NULL);
+	vma_slab = slab_cache_create ("vma", sizeof (struct vma), NULL);
+	ASSERT (page_slab != NULL && frame_slab != NULL && load_aux_slab != NULL
+			&& vma_slab != NULL);
 #ifdef EFILESYS  /* For project 4 */
 	pagecache_init ();
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&lru);
-	lock_init(&lru_lock);
-	lock_init(&kill_lock);
+	list_init (&frame_table);
+	lock_init (&frame_lock);
+	cond_init (&frame_cond);
+	lock_init (&kill_lock);
+	zero_frame = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	policy->init ();
+#ifndef EFILESYS
+	pagecache_init ();
+#endif
+	thread_create ("vm_sampler", PRI_DEFAULT, vm_sampler, NULL);
+	if (vm_writeback_rate > 0)
+		thread_create ("vm_writeback", PRI_DEFAULT, vm_writeback, NULL);
+}
+
+/* Selects the replacement policy named NAME.  Must be called
+ * before vm_init().  Returns false if there is no such policy. */
+bool
+vm_select_policy (const char *name) {
+	size_t i;
+
+	for (i = 0; i < sizeof policies / sizeof *policies; i++)
+		if (!strcmp (name, policies[i]->name)) {
+			policy = policies[i];
+			return true;
+		}
+	return false;
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -46,6 +165,7 @@ page_get_type (struct page *page) {
 /* Helpers */
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
+static bool vm_install_frame (struct page *page, struct frame *frame);
 static struct frame *vm_evict_frame (void);
 
 /* Create the pending page object with initializer. If you want to create a
@@ -65,7 +185,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
 
-		struct page *pg = (struct page*)malloc(sizeof(struct page));
+		struct page *pg = slab_alloc (page_slab);
 		if(pg == NULL)goto err;
 
 		void *va_rounded = pg_round_down(upage);
@@ -124,6 +244,47 @@ spt_insert_page (struct supplemental_page_table *spt UNUSED,
 	return succ;
 }
 
+/* Returns the page at VA in SPT like spt_find_page(), creating it
+ * first if VA is in a file mapping but has not been used yet.
+ * Returns a null pointer if VA is not mapped or memory runs out. */
+struct page *
+spt_get_page (struct supplemental_page_table *spt, void *va) {
+	struct page *page = spt_find_page (spt, va);
+	struct vma *vma;
+
+	if (page == NULL && (vma = vma_find (spt, va)) != NULL)
+		page = file_backed_materialize (vma, pg_round_down (va));
+	return page;
+}
+
+/* Returns true if no page of SPT, created or not, lies in the
+ * page-aligned range [START, END).  Looks the range up page by page
+ * only when it has fewer pages than SPT, so that checking a huge
+ * range costs no more than a walk of the table. */
+bool
+spt_range_free (struct supplemental_page_table *spt, void *start,
+		void *end) {
+	size_t cnt = ((uint8_t *) end - (uint8_t *) start) / PGSIZE;
+	struct hash_iterator i;
+	uint8_t *va;
+
+	if (vma_overlaps (spt, start, end))
+		return false;
+	if (cnt <= hash_size (&spt->spt)) {
+		for (va = start; va < (uint8_t *) end; va += PGSIZE)
+			if (spt_find_page (spt, va) != NULL)
+				return false;
+		return true;
+	}
+	hash_first (&i, &spt->spt);
+	while (hash_next (&i)) {
+		struct page *p = hash_entry (hash_cur (&i), struct page, page_elem);
+		if (p->va >= start && p->va < end)
+			return false;
+	}
+	return true;
+}
+
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	if(hash_delete(&(spt->spt), &(page->page_elem)) == NULL)return;		//그런 page는 없어요일 경우
@@ -131,136 +292,1042 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	return;
 }
 
+/* Returns true if PAGE, which must be initialized, is anonymous. */
+static bool
+is_anon (struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_ANON;
+}
+
+/* Returns true if PAGE, which must be initialized, is file-backed. */
+static bool
+is_file (struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_FILE;
+}
+
+/* Adds FRAME to the frame table and hands it to the policy. */
+static void
+frame_table_insert (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	list_push_back (&frame_table, &frame->table_elem);
+	if (++frame_cnt > vm_stats.peak_frames)
+		vm_stats.peak_frames = frame_cnt;
+	policy->on_map (frame);
+}
+
+/* Removes FRAME from the frame table.  EVICTED says whether its
+ * page is leaving memory because the policy chose it. */
+static void
+frame_table_remove (struct frame *frame, bool evicted) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	policy->on_unmap (frame, evicted);
+	list_remove (&frame->table_elem);
+	frame_cnt--;
+}
+
+/* Returns true if any page mapped to FRAME has been accessed since
+ * the last call, clearing their accessed bits. */
+bool
+vm_frame_referenced (struct frame *frame) {
+	struct page *p;
+	bool accessed = false;
+
+	for (p = frame->page; p != NULL; p = p->next_share)
+		if (pml4_is_accessed (p->pml4, p->va)) {
+			pml4_set_accessed (p->pml4, p->va, false);
+			accessed = true;
+		}
+	return accessed;
+}
+
+/* Makes PAGE the only page mapped to FRAME. */
+static void
+frame_link (struct frame *frame, struct page *page) {
+	frame->page = page;
+	frame->share_cnt = 1;
+	page->frame = frame;
+	page->next_share = NULL;
+}
+
+/* Adds PAGE to the pages sharing FRAME. */
+static void
+frame_share (struct frame *frame, struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	page->frame = frame;
+	page->next_share = frame->page;
+	frame->page = page;
+	frame->share_cnt++;
+}
+
+/* Removes PAGE, which must not be the only one, from the pages
+ * sharing FRAME and unmaps it. */
+static void
+frame_unshare (struct frame *frame, struct page *page) {
+	struct page **pp;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (frame->share_cnt > 1);
+
+	for (pp = &frame->page; *pp != page; pp = &(*pp)->next_share)
+		ASSERT (*pp != NULL);
+	*pp = page->next_share;
+	frame->share_cnt--;
+	/* A file page shared through the page cache may have been
+	 * written through PAGE: leave that for the remaining ones. */
+	if (is_file (page) && pml4_is_dirty (page->pml4, page->va))
+		pml4_set_dirty (frame->page->pml4, frame->page->va, true);
+	pml4_clear_page (page->pml4, page->va);
+	page->frame = NULL;
+	page->next_share = NULL;
+}
+
+/* Maps every page sharing FRAME, writable only if there is just
+ * one and it is writable.  File pages share a frame through the page
+ * cache rather than copy-on-write, so each is writable if it is. */
+static bool
+frame_map_all (struct frame *frame) {
+	struct page *p;
+	bool ok = true;
+
+	for (p = frame->page; p != NULL; p = p->next_share)
+		ok &= pml4_set_page (p->pml4, p->va, frame->kva, p->writable
+				&& (frame->share_cnt == 1 || is_file (p)));
+	return ok;
+}
+
+/* Returns true if any page mapped to FRAME has been written since
+ * the last call, clearing their dirty bits. */
+static bool
+frame_test_dirty (struct frame *frame) {
+	struct page *p;
+	bool dirty = false;
+
+	for (p = frame->page; p != NULL; p = p->next_share)
+		if (pml4_is_dirty (p->pml4, p->va)) {
+			pml4_set_dirty (p->pml4, p->va, false);
+			dirty = true;
+		}
+	return dirty;
+}
+
+/* Sampler thread.  Every SAMPLE_INTERVAL ticks, reports and clears
+ * the accessed bit of every frame on the table. */
+static void
+vm_sampler (void *aux UNUSED) {
+	for (;;) {
+		struct list_elem *e;
+
+		timer_sleep (SAMPLE_INTERVAL);
+		lock_acquire (&frame_lock);
+		for (e = list_begin (&frame_table); e != list_end (&frame_table);
+				e = list_next (e)) {
+			struct frame *f = list_entry (e, struct frame, table_elem);
+			policy->on_access (f, vm_frame_referenced (f));
+		}
+		vm_stats.samples++;
+		lock_release (&frame_lock);
+	}
+}
+
 /* Get the struct frame, that will be evicted. */
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
 	 /* TODO: The policy for eviction is up to you. */
-	 //LRU 순회하면서 가장 마지막에 방문했던 frame 찾아서 return
-	 lock_acquire(&lru_lock);
-	 struct list_elem *tmp = list_begin(&lru);
-	 struct list_elem *nxt_tmp;
-	 struct frame* tmp_frame;
-	 for(size_t i = 0; i < list_size(&lru); i++){
-		tmp_frame = list_entry(tmp, struct frame, lru_elem);
-		if(pml4_is_accessed(thread_current()->pml4, tmp_frame->page->va)){
-			pml4_set_accessed(thread_current()->pml4, tmp_frame->page->va, false);
-			nxt_tmp = list_next(tmp);
-			list_remove(tmp);
-			list_push_back(&lru, tmp);
-			tmp = nxt_tmp;
-			continue;
-		}
-		if(victim == NULL){
-			victim = tmp_frame;
-			nxt_tmp = list_next(tmp);
-			list_remove(tmp);
-			tmp = nxt_tmp;
-			continue;
-		}
-		tmp = list_next(tmp);
-	 }
-	 
-	 if(victim == NULL)
-			victim = list_entry(list_pop_front(&lru), struct frame, lru_elem);
-	lock_release(&lru_lock);
-	return victim;
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	return frame_cnt > 0 ? policy->pick_victim () : NULL;
+}
+
+/* Writeback thread.
+ *
+ * Dirty pages of file mappings otherwise reach their files only
+ * when they are evicted or unmapped, so a long-lived mapping can
+ * pile up dirty data that then all lands at once.  Every
+ * WRITEBACK_INTERVAL ticks the writeback thread writes back the
+ * dirty file pages it finds on the frame table, at most
+ * vm_writeback_rate of them per second, which -writeback=N sets;
+ * 0 disables the thread.
+ *
+ * A page being written back is pinned and off the table, so that it
+ * is neither evicted nor freed meanwhile, but it stays mapped.  Its
+ * dirty bit is cleared before the write, so a store that races with
+ * the write marks it dirty again for the next pass. */
+#define WRITEBACK_INTERVAL (TIMER_FREQ / 4)
+#define WRITEBACK_BATCH 32
+unsigned vm_writeback_rate = 1024;
+
+/* Pins FRAME for writeback if it holds a file page that any of the
+ * pages mapping it has written.  Returns true if it did. */
+static bool
+writeback_begin (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	if (frame->pinned || !is_file (frame->page) || !frame_test_dirty (frame))
+		return false;
+	frame_table_remove (frame, false);
+	frame->pinned = true;
+	return true;
+}
+
+/* Makes FRAME, written back, evictable again. */
+static void
+writeback_end (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	frame->pinned = false;
+	frame_table_insert (frame);
+}
+
+/* Writeback thread.  Every WRITEBACK_INTERVAL ticks, writes back
+ * up to its budget of dirty file pages, WRITEBACK_BATCH at a time. */
+static void
+vm_writeback (void *aux UNUSED) {
+	for (;;) {
+		struct frame *batch[WRITEBACK_BATCH];
+		size_t budget, cnt, i;
+
+		timer_sleep (WRITEBACK_INTERVAL);
+		budget = vm_writeback_rate * WRITEBACK_INTERVAL / TIMER_FREQ;
+		if (budget == 0)
+			budget = 1;
+		do {
+			struct list_elem *e, *next;
+
+			/* Frames written back go to the end of the table, so
+			 * each batch starts where the last one left off. */
+			cnt = 0;
+			lock_acquire (&frame_lock);
+			for (e = list_begin (&frame_table);
+					e != list_end (&frame_table)
+					&& cnt < WRITEBACK_BATCH && cnt < budget; e = next) {
+				struct frame *f = list_entry (e, struct frame, table_elem);
+				next = list_next (e);
+				if (writeback_begin (f))
+					batch[cnt++] = f;
+			}
+			lock_release (&frame_lock);
+
+			for (i = 0; i < cnt; i++)
+				file_backed_write_page (batch[i]->page, batch[i]->kva);
+
+			lock_acquire (&frame_lock);
+			for (i = 0; i < cnt; i++)
+				writeback_end (batch[i]);
+			cond_broadcast (&frame_cond, &frame_lock);
+			vm_stats.wb_pages += cnt;
+			lock_release (&frame_lock);
+			budget -= cnt;
+		} while (cnt == WRITEBACK_BATCH && budget > 0);
+		vm_stats.wb_passes++;
+	}
+}
+
+/* Takes FRAME, the policy's choice, off the table and unmaps it
+ * from every page sharing it, so that their owners fault and wait
+ * if they touch the page before the contents are safely written
+ * out. */
+static void
+evict_begin (struct frame *frame) {
+	struct page *p;
+
+	frame_table_remove (frame, true);
+	frame->pinned = true;
+	for (p = frame->page; p != NULL; p = p->next_share)
+		pml4_clear_page (p->pml4, p->va);
+
+	/* Pages sharing a file frame through the page cache may each
+	 * have written it; the first page writes it back for all. */
+	if (is_file (frame->page) && frame_test_dirty (frame))
+		pml4_set_dirty (frame->page->pml4, frame->page->va, true);
 }
 
 /* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+ * Return NULL on error.
+ *
+ * Anonymous victims are evicted in clusters: while the policy keeps
+ * choosing anonymous pages, up to SWAP_CLUSTER of them are written
+ * to swap in one transfer.  The extra frames go back to the user
+ * pool, where the faults that follow find them without evicting.
+ *
+ * A frame shared copy-on-write is written out once, and every page
+ * sharing it is left pointing at the same swap slot.  A file frame
+ * shared through the page cache is written back once, by its first
+ * page, for all the pages that wrote it. */
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim  = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
-	//vm 관련 수정사항
-	if(!swap_out(victim->page))return NULL;	
-	victim->page = NULL;
-	memset(victim->kva, 0, PGSIZE);
+	struct frame *batch[SWAP_CLUSTER];
+	struct page *pages[SWAP_CLUSTER];
+	size_t attempts;
+
+	lock_acquire (&frame_lock);
+	for (attempts = frame_cnt; attempts > 0; attempts--) {
+		struct frame *victim = vm_get_victim ();
+		size_t cnt, written, i;
 
-	return victim;
+		if (victim == NULL)
+			break;
+		evict_begin (victim);
+		batch[0] = victim;
+		pages[0] = victim->page;
+		cnt = 1;
+		if (is_anon (victim->page))
+			while (cnt < SWAP_CLUSTER) {
+				struct frame *f = vm_get_victim ();
+				if (f == NULL || !is_anon (f->page))
+					break;
+				evict_begin (f);
+				batch[cnt] = f;
+				pages[cnt++] = f->page;
+			}
+		lock_release (&frame_lock);
+
+		/* TODO: swap out the victim and return the evicted frame. */
+		if (is_anon (pages[0]))
+			written = anon_swap_out_cluster (pages, cnt);
+		else
+			written = swap_out (pages[0]) ? 1 : 0;
+
+		lock_acquire (&frame_lock);
+		for (i = 0; i < cnt; i++) {
+			struct frame *f = batch[i];
+			if (i < written) {
+				struct page *p, *next;
+				page_cache_remove (f);
+				for (p = f->page; p != NULL; p = next) {
+					next = p->next_share;
+					p->frame = NULL;
+					p->next_share = NULL;
+				}
+				f->page = NULL;
+				f->share_cnt = 0;
+				vm_stats.evictions++;
+			} else {
+				/* Could not write the page out: map it back. */
+				frame_map_all (f);
+				f->pinned = false;
+				frame_table_insert (f);
+				vm_stats.evict_failures++;
+			}
+		}
+		cond_broadcast (&frame_cond, &frame_lock);
+		if (written > 0) {
+			lock_release (&frame_lock);
+			for (i = 1; i < written; i++)
+				vm_free_frame (batch[i]);
+			return victim;
+		}
+	}
+	lock_release (&frame_lock);
+	return NULL;
+}
+
+/* Returns a frame from the user pool, pinned and off the frame
+ * table, or NULL if none is free.  Never evicts. */
+struct frame *
+vm_get_free_frame (void) {
+	struct frame *frame;
+	void *pg_ptr = palloc_get_page(PAL_USER);
+	if(pg_ptr == NULL)return NULL;
+
+	frame = slab_alloc (frame_slab);	//new frame slab에서 할당
+	if (frame == NULL) {
+		palloc_free_page (pg_ptr);
+		return NULL;
+	}
+	frame->kva = pg_ptr;
+	frame->page = NULL;
+	frame->share_cnt = 0;
+	frame->pinned = true;
+	frame->cache_inode = NULL;
+	return frame;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * space.
+ * The frame comes back pinned and off the frame table; it returns
+ * NULL only if every resident page is pinned or unwritable. */
 static struct frame *
 vm_get_frame (void) {
 	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
 	//vm 관련 추가사항		새로운 frame 할당하고 초기화 한다.
-	void *pg_ptr = palloc_get_page(PAL_USER);
-	if(pg_ptr == NULL)return vm_evict_frame();
+	frame = vm_get_free_frame ();
+	if (frame == NULL)
+		frame = vm_evict_frame ();
 
-	frame = (struct frame*)malloc(sizeof(struct frame));	//new frame malloc으로 할당
-	frame->kva = pg_ptr;
-	frame->page = NULL;
-	
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	ASSERT (frame == NULL || frame->page == NULL);
+	return frame;
+}
+
+/* Maps PAGE of the current process to FRAME, which the caller got
+ * from vm_get_free_frame() and filled, and makes it evictable.
+ * Frees FRAME and returns false if the page cannot be mapped. */
+bool
+vm_map_frame (struct page *page, struct frame *frame) {
+	struct thread *t = thread_current ();
+
+	if (!pml4_set_page (t->pml4, page->va, frame->kva, page->writable)) {
+		vm_free_frame (frame);
+		return false;
+	}
+	page->pml4 = t->pml4;
+	frame_link (frame, page);
+
+	lock_acquire (&frame_lock);
+	frame->pinned = false;
+	frame_table_insert (frame);
+	vm_stats.swap_ins++;
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* Detaches PAGE from its frame, if it has one, and returns the
+ * frame, unmapped and off the frame table, for the caller to write
+ * back and release with vm_free_frame().  If the frame is being
+ * evicted, waits for that to finish first, in which case there is
+ * no frame left to return.  Neither is there if other pages still
+ * share the frame; PAGE just stops sharing it. */
+struct frame *
+vm_take_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	while (page->frame != NULL && page->frame->pinned)
+		cond_wait (&frame_cond, &frame_lock);
+	frame = page->frame;
+	if (frame != NULL && frame->share_cnt > 1) {
+		frame_unshare (frame, page);
+		frame = NULL;
+	} else if (frame != NULL) {
+		frame_table_remove (frame, false);
+		frame->pinned = true;
+		pml4_clear_page (page->pml4, page->va);
+		page->frame = NULL;
+		frame->page = NULL;
+		frame->share_cnt = 0;
+	}
+	lock_release (&frame_lock);
 	return frame;
 }
 
-/* Growing the stack. */
+/* Returns FRAME, which must be off the frame table, and its page
+ * to the user pool. */
+void
+vm_free_frame (struct frame *frame) {
+	ASSERT (frame->pinned);
+
+	/* A frame taken from a file page leaves the page cache only
+	 * now, once it is written back, so that no one reads the page
+	 * from the file before. */
+	if (frame->cache_inode != NULL) {
+		lock_acquire (&frame_lock);
+		page_cache_remove (frame);
+		cond_broadcast (&frame_cond, &frame_lock);
+		lock_release (&frame_lock);
+	}
+	palloc_free_page (frame->kva);
+	slab_free (frame_slab, frame);
+}
+
+/* Growing the stack.  The new pages are only reserved here; each
+ * is claimed, or mapped to the zero frame, when it is first
+ * touched. */
 static void
 vm_stack_growth (void *addr UNUSED) {
 	void *pg_addr = pg_round_down(addr);
-	if((uintptr_t)USER_STACK - (uintptr_t)pg_addr <= (1<<20))return;
+	if((uintptr_t)USER_STACK - (uintptr_t)pg_addr > (1<<20))return;
 
-	while(vm_alloc_page(VM_ANON, pg_addr, true)){
-		struct page *pg = spt_find_page(&thread_current()->spt, pg_addr);
-		vm_claim_page(pg_addr);
+	while(vm_alloc_page(VM_ANON, pg_addr, true))
 		pg_addr += PGSIZE;
+}
+
+/* Returns true if PAGE is an anonymous page that has not been
+ * touched yet and has nothing to load, so that it reads as zeros. */
+static bool
+page_is_zero_fill (struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_UNINIT
+		&& VM_TYPE (page->uninit.type) == VM_ANON
+		&& page->uninit.init == NULL;
+}
+
+/* Transparent superpages
+ *
+ * When a process first writes to a page of an aligned 2 MB region
+ * whose pages are all reserved, writable, zero-filled and not yet
+ * mapped, and the user pool has 2 MB of aligned free memory, the
+ * whole region is mapped with one page directory entry.  A read
+ * maps the shared zero frame instead, as for any other zero-fill
+ * page, so a region that is only read never costs 2 MB, and one
+ * whose pages have been read is no longer a candidate.  Each 4 kB
+ * page still gets a frame of its own on the frame table, so
+ * eviction, fork and munmap work as before: changing the mapping of
+ * any one page splits the superpage into 4 kB pages first.  The
+ * pages share one accessed bit, so under memory pressure the policy
+ * soon picks one of them and splits it. */
+bool vm_thp = true;
+
+/* Maps the 2 MB region around PAGE, which is zero-fill, with a
+ * superpage if it qualifies.  Returns true if successful. */
+static bool
+vm_try_large (struct page *page) {
+	struct thread *t = thread_current ();
+	uint8_t *base = (uint8_t *) ((uint64_t) page->va & ~(LARGE_PGSIZE - 1));
+	struct list frames;
+	uint8_t *block;
+	size_t i;
+
+	if (!vm_thp)
+		return false;
+	for (i = 0; i < LARGE_PGCNT; i++) {
+		struct page *p = spt_find_page (&t->spt, base + i * PGSIZE);
+		if (p == NULL || !page_is_zero_fill (p) || !p->writable
+				|| p->zero_mapped)
+			return false;
+	}
+
+	block = palloc_get_aligned (PAL_USER, LARGE_PGCNT, LARGE_PGCNT);
+	if (block == NULL) {
+		vm_stats.large_fallbacks++;
+		return false;
+	}
+	list_init (&frames);
+	for (i = 0; i < LARGE_PGCNT; i++) {
+		struct frame *frame = slab_alloc (frame_slab);
+		if (frame == NULL)
+			break;
+		frame->kva = block + i * PGSIZE;
+		frame->page = NULL;
+		frame->share_cnt = 0;
+		frame->pinned = true;
+		list_push_back (&frames, &frame->table_elem);
 	}
+	if (i < LARGE_PGCNT
+			|| !pml4_set_large_page (t->pml4, base, block, true)) {
+		while (!list_empty (&frames))
+			slab_free (frame_slab, list_entry (list_pop_front (&frames),
+						struct frame, table_elem));
+		palloc_free_multiple (block, LARGE_PGCNT);
+		vm_stats.large_fallbacks++;
+		return false;
+	}
+
+	/* The process cannot run until this returns, so it does not
+	 * matter that the pages are mapped before they are zeroed. */
+	for (i = 0; i < LARGE_PGCNT; i++) {
+		struct page *p = spt_find_page (&t->spt, base + i * PGSIZE);
+		struct frame *frame = list_entry (list_pop_front (&frames),
+				struct frame, table_elem);
+		bool ok UNUSED;
+
+		p->pml4 = t->pml4;
+		frame_link (frame, p);
+		ok = swap_in (p, frame->kva);
+		ASSERT (ok);
+
+		lock_acquire (&frame_lock);
+		frame->pinned = false;
+		frame_table_insert (frame);
+		lock_release (&frame_lock);
+	}
+	vm_stats.large_maps++;
+	return true;
 }
 
-/* Handle the fault on write_protected page */
+/* Handle the fault on write_protected page
+ *
+ * PAGE is writable but mapped read-only because it shares its frame
+ * copy-on-write.  If it is the last page sharing the frame, it
+ * takes the frame over; otherwise it gets a private copy.  If the
+ * frame is evicted meanwhile there is nothing to copy, and the
+ * retried access faults the page back in. */
 static bool
 vm_handle_wp (struct page *page UNUSED) {
-	void *parent_kva = page->frame->kva;
-	page->frame->kva = palloc_get_page(PAL_USER);
+	struct frame *frame, *copy = NULL;
+	bool success = true;
 
-	memcpy(page->frame->kva, parent_kva, PGSIZE);
-	pml4_set_page(thread_current()->pml4, page->va, page->frame->kva, page->copy_writable);
-	return true;
+	lock_acquire (&frame_lock);
+	for (;;) {
+		while (page->frame != NULL && page->frame->pinned)
+			cond_wait (&frame_cond, &frame_lock);
+		frame = page->frame;
+		if (frame == NULL || frame->share_cnt == 1 || copy != NULL)
+			break;
+
+		/* Allocating may evict, so do it unlocked and look again. */
+		lock_release (&frame_lock);
+		copy = vm_get_frame ();
+		lock_acquire (&frame_lock);
+		if (copy == NULL) {
+			success = false;
+			break;
+		}
+	}
+
+	if (frame != NULL && frame->share_cnt == 1) {
+		/* Last writer: no need to copy. */
+		pml4_clear_page (page->pml4, page->va);
+		pml4_set_page (page->pml4, page->va, frame->kva, true);
+		vm_stats.cow_reuses++;
+	} else if (frame != NULL && copy != NULL) {
+		memcpy (copy->kva, frame->kva, PGSIZE);
+		frame_unshare (frame, page);
+		success = pml4_set_page (page->pml4, page->va, copy->kva, true);
+		if (success) {
+			frame_link (copy, page);
+			copy->pinned = false;
+			frame_table_insert (copy);
+			copy = NULL;
+			vm_stats.cow_copies++;
+		}
+	}
+	lock_release (&frame_lock);
+
+	if (copy != NULL)
+		vm_free_frame (copy);
+	return success;
+}
+
+/* Fault-around
+ *
+ * A fault on a page that loads from a file is usually followed by
+ * faults on the pages next to it.  So the untouched pages around
+ * the faulting one, within an aligned window of FAULT_AROUND pages,
+ * that load from the following offsets of the same file are read
+ * with it, in one batched read.  Neighbors only get frames that are
+ * free already; reading ahead never evicts.  Each mapping and each
+ * executable segment keeps its own FAULT_AROUND, initially
+ * vm_fault_around, which -faultaround=N sets. */
+#define FAULT_AROUND_MAX 64
+unsigned vm_fault_around = 16;
+
+/* Sets up LOAD to read PAGE_READ_BYTES from FILE at OFS and zero the
+ * rest of the page. */
+void
+vm_lazy_init (struct lazy_load *load, struct file *file, off_t ofs,
+		size_t page_read_bytes) {
+	ASSERT (page_read_bytes <= PGSIZE);
+	load->file = file;
+	load->ofs = ofs;
+	load->page_read_bytes = page_read_bytes;
+	load->page_zero_bytes = PGSIZE - page_read_bytes;
+	load->fault_around = vm_fault_around;
+	load->prefetched = false;
+}
+
+/* Fills the page at KVA as LOAD describes, unless fault-around has
+ * already.  Returns true if successful. */
+bool
+vm_lazy_read (struct lazy_load *load, void *kva) {
+	off_t read;
+
+	if (load->prefetched)
+		return true;
+	read = file_read_at (load->file, kva, load->page_read_bytes, load->ofs);
+	memset ((uint8_t *) kva + read, 0, PGSIZE - read);
+	vm_stats.file_loads++;
+	vm_stats.file_reads++;
+	return read == (off_t) load->page_read_bytes;
+}
+
+/* Returns the lazy_load of PAGE if it loads from a file and has not
+ * been touched, otherwise a null pointer. */
+static struct lazy_load *
+page_lazy_load (struct page *page) {
+	if (page == NULL || VM_TYPE (page->operations->type) != VM_UNINIT
+			|| !(page->uninit.type & VM_LAZY_FILE))
+		return NULL;
+	return page->uninit.aux;
+}
+
+/* Returns the inode of the file that PAGE is a page of, if it is
+ * part of a file mapping, and its offset in the file in *OFS.
+ * Otherwise returns a null pointer. */
+static struct inode *
+page_file_key (struct page *page, off_t *ofs) {
+	if (page_get_type (page) != VM_FILE)
+		return NULL;
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		struct lazy_load *load = page->uninit.aux;
+		*ofs = load->ofs;
+		return file_get_inode (load->file);
+	}
+	*ofs = page->file.ofs;
+	return file_get_inode (page->file.file);
+}
+
+/* Returns the frame of the page cache that holds the part of INODE
+ * at OFS, once no transfer is under way on it, or a null pointer. */
+static struct frame *
+page_cache_get (struct inode *inode, off_t ofs) {
+	struct frame *frame;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	while ((frame = page_cache_lookup (inode, ofs)) != NULL && frame->pinned)
+		cond_wait (&frame_cond, &frame_lock);
+	return frame;
+}
+
+/* Returns true if PAGE is part of a file mapping and a frame of the
+ * page cache already holds its contents. */
+static bool
+page_cached (struct page *page) {
+	struct inode *inode;
+	off_t ofs;
+	bool cached;
+
+	if ((inode = page_file_key (page, &ofs)) == NULL)
+		return false;
+	lock_acquire (&frame_lock);
+	cached = page_cache_lookup (inode, ofs) != NULL;
+	lock_release (&frame_lock);
+	return cached;
+}
+
+/* Maps PAGE, part of a file mapping and without a frame, to the frame
+ * of the page cache that holds its contents, if some mapping of the
+ * same file, in any process, has loaded them.  Returns true if it
+ * did. */
+static bool
+page_cache_map (struct page *page) {
+	struct thread *t = thread_current ();
+	struct frame *frame;
+	struct inode *inode;
+	off_t ofs;
+	bool success = false;
+
+	if ((inode = page_file_key (page, &ofs)) == NULL)
+		return false;
+	lock_acquire (&frame_lock);
+	frame = page_cache_get (inode, ofs);
+	if (frame != NULL
+			&& pml4_set_page (t->pml4, page->va, frame->kva, page->writable)) {
+		if (VM_TYPE (page->operations->type) == VM_UNINIT)
+			file_backed_adopt (page);
+		page->pml4 = t->pml4;
+		frame_share (frame, page);
+		vm_stats.cache_maps++;
+		success = true;
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Copies SIZE bytes between BUF, a kernel buffer, and the frame of
+ * the page cache that holds the part of INODE at OFS: into the frame
+ * if WRITE, otherwise out of it.  The bytes must lie within one page.
+ * Returns false if no frame holds them. */
+bool
+vm_cache_copy (struct inode *inode, off_t ofs, void *buf, size_t size,
+		bool write) {
+	size_t pg_ofs = ofs % PGSIZE;
+	struct frame *frame;
+
+	ASSERT (pg_ofs + size <= PGSIZE);
+	lock_acquire (&frame_lock);
+	frame = page_cache_get (inode, ofs - pg_ofs);
+	if (frame != NULL) {
+		if (write)
+			memcpy ((uint8_t *) frame->kva + pg_ofs, buf, size);
+		else
+			memcpy (buf, (uint8_t *) frame->kva + pg_ofs, size);
+		page_cache_hit (write);
+	}
+	lock_release (&frame_lock);
+	return frame != NULL;
+}
+
+/* Returns true if NEXT's contents follow PREV's in the same file. */
+static bool
+lazy_load_adjacent (const struct lazy_load *prev,
+		const struct lazy_load *next) {
+	return prev->page_read_bytes == PGSIZE && next->page_read_bytes > 0
+		&& next->ofs == prev->ofs + PGSIZE
+		&& file_get_inode (prev->file) == file_get_inode (next->file);
+}
+
+/* Loads PAGE, which loads from a file, together with the untouched
+ * pages that continue the same file around it, within the WINDOW
+ * pages starting F pages before PAGE.  If EVICT is false, PAGE too
+ * only gets a frame that is free already.  Returns true if PAGE
+ * was loaded. */
+static bool
+load_run (struct page *page, size_t f, size_t window, bool evict) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *pages[FAULT_AROUND_MAX];
+	struct frame *frames[FAULT_AROUND_MAX];
+	void *kvas[FAULT_AROUND_MAX];
+	struct lazy_load *load;
+	size_t lo, hi, i;
+	uint8_t *base;
+	off_t size, read;
+	bool success = false;
+
+	ASSERT (f < window && window <= FAULT_AROUND_MAX);
+
+	/* Find the run of pages [LO, HI) around PAGE, at index F. */
+	base = (uint8_t *) page->va - f * PGSIZE;
+	pages[f] = page;
+	for (lo = f; lo > 0; lo--) {
+		struct page *p = spt_get_page (spt, base + (lo - 1) * PGSIZE);
+		struct lazy_load *l = page_lazy_load (p);
+		if (l == NULL || !lazy_load_adjacent (l, page_lazy_load (pages[lo]))
+				|| page_cached (p))
+			break;
+		pages[lo - 1] = p;
+	}
+	for (hi = f + 1; hi < window; hi++) {
+		struct page *p = spt_get_page (spt, base + hi * PGSIZE);
+		struct lazy_load *l = page_lazy_load (p);
+		if (l == NULL
+				|| !lazy_load_adjacent (page_lazy_load (pages[hi - 1]), l)
+				|| page_cached (p))
+			break;
+		pages[hi] = p;
+	}
+	if (hi - lo == 1 && evict)
+		return vm_do_claim_page (page);
+
+	/* Take free frames for the neighbors, trimming the run where
+	 * there are none, then a frame for PAGE. */
+	for (i = lo; i < hi; i++)
+		frames[i] = i != f ? vm_get_free_frame () : NULL;
+	for (i = lo; i < f; i++)
+		if (frames[i] == NULL) {
+			while (lo <= i) {
+				if (frames[lo] != NULL)
+					vm_free_frame (frames[lo]);
+				lo++;
+			}
+		}
+	for (i = f + 1; i < hi && frames[i] != NULL; i++)
+		continue;
+	while (hi > i)
+		if (frames[--hi] != NULL)
+			vm_free_frame (frames[hi]);
+	frames[f] = evict ? vm_get_frame () : vm_get_free_frame ();
+	if (frames[f] == NULL)
+		goto done;
+
+	/* Read the run. */
+	for (i = lo; i < hi; i++)
+		kvas[i - lo] = frames[i]->kva;
+	load = page_lazy_load (pages[lo]);
+	size = (off_t) (hi - lo - 1) * PGSIZE
+		+ page_lazy_load (pages[hi - 1])->page_read_bytes;
+	read = file_read_pages (load->file, kvas, size, load->ofs);
+	vm_stats.file_reads++;
+
+	/* Keep the pages read in full; PAGE must be one of them. */
+	for (i = lo; i < hi; i++) {
+		struct lazy_load *l = page_lazy_load (pages[i]);
+		if (read < (off_t) ((i - lo) * PGSIZE + l->page_read_bytes))
+			break;
+		memset ((uint8_t *) frames[i]->kva + l->page_read_bytes, 0,
+				l->page_zero_bytes);
+	}
+	if (i <= f)
+		goto done;
+	while (hi > i)
+		vm_free_frame (frames[--hi]);
+
+	/* Map them. */
+	vm_stats.file_loads += hi - lo;
+	if (hi - lo > 1) {
+		vm_stats.around_faults++;
+		vm_stats.around_pages += hi - lo - 1;
+	}
+	for (i = lo; i < hi; i++) {
+		bool ok;
+
+		page_lazy_load (pages[i])->prefetched = true;
+		ok = vm_install_frame (pages[i], frames[i]);
+		if (i == f)
+			success = ok;
+		frames[i] = NULL;
+	}
+
+done:
+	for (i = lo; i < hi; i++)
+		if (frames[i] != NULL)
+			vm_free_frame (frames[i]);
+	return success;
+}
+
+/* Loads PAGE, which faulted and loads from a file, along with its
+ * neighbors: the aligned window of its mapping's FAULT_AROUND pages
+ * around it, or under MADV_SEQUENTIAL the FAULT_AROUND_MAX pages
+ * from PAGE on.  Returns true if successful. */
+static bool
+fault_around (struct page *page) {
+	size_t window = page_lazy_load (page)->fault_around;
+
+	if (page->advice == MADV_SEQUENTIAL)
+		return load_run (page, 0, FAULT_AROUND_MAX, true);
+	if (window > FAULT_AROUND_MAX)
+		window = FAULT_AROUND_MAX;
+	if (window <= 1)
+		return vm_do_claim_page (page);
+	return load_run (page, pg_no (page->va) % window, window, true);
+}
+
+/* Returns the fault-around window for pages under ADVICE, one of
+ * MADV_NORMAL, MADV_RANDOM and MADV_SEQUENTIAL. */
+unsigned
+vm_advice_fault_around (int advice) {
+	return advice == MADV_RANDOM ? 1
+		: advice == MADV_SEQUENTIAL ? FAULT_AROUND_MAX : vm_fault_around;
+}
+
+/* Sets the access hint of PAGE, part of a file mapping, to ADVICE,
+ * one of MADV_NORMAL, MADV_RANDOM and MADV_SEQUENTIAL. */
+void
+vm_set_advice (struct page *page, int advice) {
+	struct lazy_load *load = page_lazy_load (page);
+
+	page->advice = advice;
+	if (load != NULL)
+		load->fault_around = vm_advice_fault_around (advice);
+}
+
+/* Loads PAGE, if it is not resident, and as many of the CNT - 1
+ * pages that follow it as can go in the same read, into frames that
+ * are free now.  Returns false if PAGE could not be loaded. */
+bool
+vm_prefetch (struct page *page, size_t cnt) {
+	struct frame *frame;
+
+	if (page->frame != NULL || page_cache_map (page))
+		return true;
+	if (page_lazy_load (page) != NULL)
+		return load_run (page, 0, cnt < FAULT_AROUND_MAX ? cnt
+				: FAULT_AROUND_MAX, false);
+	if (page->zero_mapped || (frame = vm_get_free_frame ()) == NULL)
+		return false;
+	return vm_install_frame (page, frame);
+}
+
+/* Releases the frame of PAGE, part of a file mapping, writing it
+ * back first if it is dirty.  The next access faults it back in. */
+void
+vm_drop_page (struct page *page) {
+	if (page->frame != NULL) {
+		file_backed_drop (page);
+		vm_stats.drops++;
+	}
+}
+
+/* Writes PAGE, part of a file mapping, back to its file now if it
+ * is resident and dirty. */
+void
+vm_sync_page (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	while (page->frame != NULL && page->frame->pinned)
+		cond_wait (&frame_cond, &frame_lock);
+	frame = page->frame;
+	if (frame == NULL || !writeback_begin (frame)) {
+		lock_release (&frame_lock);
+		return;
+	}
+	lock_release (&frame_lock);
+
+	file_backed_write_page (page, frame->kva);
+
+	lock_acquire (&frame_lock);
+	writeback_end (frame);
+	cond_broadcast (&frame_cond, &frame_lock);
+	vm_stats.sync_pages++;
+	lock_release (&frame_lock);
+}
+
+/* Drop-behind
+ *
+ * A process that reads a mapping under MADV_SEQUENTIAL is unlikely
+ * to come back soon to what it read a while ago.  So after each
+ * fault, the clean resident pages of the mapping between one and two
+ * read-ahead windows behind the faulting page are released at once,
+ * before they crowd out pages that will be used. */
+static void
+drop_behind (struct page *page) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *va = page->va;
+	size_t i;
+
+	for (i = FAULT_AROUND_MAX; i < 2 * FAULT_AROUND_MAX; i++) {
+		struct page *p;
+
+		if ((uintptr_t) va < (i + 1) * PGSIZE)
+			break;
+		p = spt_find_page (spt, va - (i + 1) * PGSIZE);
+		if (p == NULL || p->advice != MADV_SEQUENTIAL)
+			break;
+		if (p->frame != NULL && !pml4_is_dirty (p->pml4, p->va))
+			vm_drop_page (p);
+	}
 }
 
 /* Return true on success */
 bool
 vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
+	struct thread *cur = thread_current ();
+	struct supplemental_page_table *spt UNUSED = &cur->spt;
 	struct page *page = NULL;
+	bool success;
 	/* TODO: Validate the fault */
 	/* TODO: Your code goes here */
-	if(is_kernel_vaddr(addr) && user)return false;
-	page = spt_find_page(spt, addr);
-	if(write && !not_present && page->copy_writable && page)
-		return vm_handle_wp(page);
+	if (addr == NULL || is_kernel_vaddr (addr))
+		return false;
+	vm_stats.faults++;
+
+	page = spt_get_page(spt, addr);
+	if (!not_present) {
+		/* Write to a present read-only mapping of a writable page:
+		 * the zero frame or a frame shared copy-on-write. */
+		if (page == NULL || !write || !page->writable)
+			return false;
+		if (!page->zero_mapped)
+			return vm_handle_wp(page);
+		pml4_clear_page (cur->pml4, page->va);
+		page->zero_mapped = false;
+		vm_stats.zero_copies++;
+		return vm_do_claim_page (page);
+	}
 
 	if(page == NULL){
-		struct thread *cur = thread_current();
-		void *stack_bottom = pg_round_down(cur->user_rsp);
-		if(write && (addr >= pg_round_down(cur->user_rsp - PGSIZE)) && (addr < USER_STACK)){
-			vm_stack_growth(addr);
-			return true;
-		}
-		return false;
+		/* The user stack pointer is in F for faults from user code
+		 * and was saved on entry for faults inside system calls.
+		 * PUSH writes 8 bytes below it before moving it. */
+		uint8_t *rsp = (uint8_t *) (user ? f->rsp : cur->user_rsp);
+		if ((uint8_t *) addr < rsp - 8 || addr >= (void *) USER_STACK)
+			return false;
+		vm_stack_growth(addr);
+		page = spt_find_page (spt, addr);
+		if (page == NULL)
+			return false;
 	}
-	
-	// printf("page->writable : %d\n", page->writable);
-	// printf("write : %d\n", write);
-	// printf("EQUALS ? : %d\n", page->writable == write);
-	// if (is_writable(thread_current()->pml4) && write)
-	// {
-	// 	printf("wp\n");
-	// 	return vm_handle_wp(page);
-	// };
 
 	if(write && !page->writable)return false;
-	if(vm_do_claim_page(page))return true;
-	return false;
+	if (write && page_is_zero_fill (page) && vm_try_large (page))
+		return true;
+	if (!write && page_is_zero_fill (page)) {
+		if (!pml4_set_page (cur->pml4, page->va, zero_frame, false))
+			return false;
+		page->zero_mapped = true;
+		vm_stats.zero_maps++;
+		return true;
+	}
+	if (page_cache_map (page))
+		success = true;
+	else if (page_lazy_load (page) != NULL)
+		success = fault_around (page);
+	else
+		success = vm_do_claim_page (page);
+	if (success && page->advice == MADV_SEQUENTIAL)
+		drop_behind (page);
+	return success;
 }
 
 /* Free the page.
@@ -268,7 +1335,7 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 void
 vm_dealloc_page (struct page *page) {
 	destroy (page);
-	free (page);
+	slab_free (page_slab, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -288,19 +1355,68 @@ vm_do_claim_page (struct page *page) {
 	struct frame *frame = vm_get_frame ();
 	//vm
 	if(frame == NULL)return false;
+	return vm_install_frame (page, frame);
+}
+
+/* Indexes FRAME, which holds the contents of PAGE, a file page, in
+ * the page cache.  Returns false if another frame holds them. */
+static bool
+frame_cache_insert (struct page *page, struct frame *frame) {
+	bool inserted;
+
+	lock_acquire (&frame_lock);
+	inserted = page_cache_insert (frame, file_get_inode (page->file.file),
+			page->file.ofs);
+	lock_release (&frame_lock);
+	return inserted;
+}
+
+/* Fills FRAME, which is pinned and off the frame table, with the
+ * contents of PAGE and maps it.  Frees FRAME and returns false if
+ * that fails. */
+static bool
+vm_install_frame (struct page *page, struct frame *frame) {
+	struct thread *t = thread_current ();
+	bool reload = VM_TYPE (page->operations->type) != VM_UNINIT;
 
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	page->pml4 = t->pml4;
+	frame_link (frame, page);
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
-	struct thread *t = thread_current();
-	lock_acquire(&lru_lock);
-	list_push_back(&lru, &frame->lru_elem);
-	lock_release(&lru_lock);
-	if(pml4_set_page(t->pml4, page->va, frame->kva, page->writable)==false)
-		return false;
-	return swap_in (page, frame->kva);
+	/* Fill the frame while it is pinned, then map it; the page
+	 * becomes visible to the clock only once it is mapped.  A file
+	 * page enters the page cache before it is mapped, still pinned,
+	 * so that no one reads the file around it. */
+	if (!swap_in (page, frame->kva))
+		goto fail;
+	while (is_file (page) && !frame_cache_insert (page, frame)) {
+		/* Another process loaded the same page while this one did.
+		 * Share its frame; if that has gone since, written back,
+		 * read the page again. */
+		if (page_cache_map (page)) {
+			vm_free_frame (frame);
+			return true;
+		}
+		if (!swap_in (page, frame->kva))
+			goto fail;
+	}
+	if (!pml4_set_page (t->pml4, page->va, frame->kva, page->writable))
+		goto fail;
+
+	lock_acquire (&frame_lock);
+	frame->pinned = false;
+	frame_table_insert (frame);
+	if (frame->cache_inode != NULL)
+		cond_broadcast (&frame_cond, &frame_lock);
+	if (reload)
+		vm_stats.swap_ins++;
+	lock_release (&frame_lock);
+	return true;
+
+fail:
+	page->frame = NULL;
+	vm_free_frame (frame);
+	return false;
 }
 
 //vm 관련 추가 함수
@@ -327,73 +1443,130 @@ void
 supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 	//vm 관련 수정
 	hash_init(&(spt->spt), spt_hash_func, spt_less_func, NULL);
+	vma_init (spt);
+}
+
+/* Makes DST, the child's copy of the parent's resident or swapped
+ * out page SRC, share SRC's frame or swap slot.  Anonymous pages
+ * stay mapped read-only until one of them writes.  File pages share
+ * the frame through the page cache, writable if their mapping is,
+ * as any two mappings of the same part of a file do. */
+static bool
+page_share (struct page *dst, struct page *src) {
+	struct frame *frame;
+	bool success = true;
+
+	lock_acquire (&frame_lock);
+	while (src->frame != NULL && src->frame->pinned)
+		cond_wait (&frame_cond, &frame_lock);
+	frame = src->frame;
+
+	if (frame == NULL) {
+		if (is_anon (src) && src->anon.slot != SWAP_SLOT_NONE) {
+			swap_dup (src->anon.slot);
+			dst->anon.slot = src->anon.slot;
+		}
+	} else if (is_file (src)) {
+		success = pml4_set_page (dst->pml4, dst->va, frame->kva, dst->writable);
+		if (success) {
+			frame_share (frame, dst);
+			vm_stats.fork_shares++;
+		}
+	} else {
+		success = pml4_set_page (dst->pml4, dst->va, frame->kva, false);
+		if (success) {
+			frame_share (frame, dst);
+			pml4_clear_page (src->pml4, src->va);
+			pml4_set_page (src->pml4, src->va, frame->kva, false);
+			vm_stats.fork_shares++;
+		}
+	}
+	lock_release (&frame_lock);
+	return success;
 }
 
-/* Copy supplemental page table from src to dst */
+/* Copy supplemental page table from src to dst
+ *
+ * Runs in the child, while the parent waits in fork.  File mappings
+ * are copied as vmas, each with a duplicate of its file; their
+ * untouched pages are left for the child to create when it uses
+ * them.  Other pages not yet loaded are set up to load the same way
+ * in the child; the rest are shared copy-on-write. */
 bool 
 supplemental_page_table_copy(struct supplemental_page_table *dst,
                                   struct supplemental_page_table *src)
 {
+  struct thread *t = thread_current ();
   struct hash_iterator iter;
+  int64_t start = timer_ticks ();
+  bool success = vma_copy (dst, src);
+
   hash_first(&iter, &(src->spt));
-  while (hash_next(&iter))
+  while (success && hash_next(&iter))
   {
     struct page *tmp = hash_entry(hash_cur(&iter), struct page, page_elem);
     struct page *cpy = NULL;
-    // printf("curr_type: %d, parent_va: %p, aux: %p\n", VM_TYPE(tmp->operations->type), tmp->va, tmp->uninit.aux);
 
     switch (VM_TYPE(tmp->operations->type))
     {
     	case VM_UNINIT:
-      // printf("tmp->uninit.type: %d, va: %p, aux: %p\n", tmp->uninit.type, tmp->va, tmp->uninit.aux);
       	if (VM_TYPE(tmp->uninit.type) == VM_ANON)
       	{
-        	struct load_segment_aux *info = (struct load_segment_aux *)malloc(sizeof(struct load_segment_aux));
-        	memcpy(info, tmp->uninit.aux, sizeof(struct load_segment_aux));
-
-        	info->file = file_duplicate(info->file);
+        	struct load_segment_aux *info = NULL;
+			if (tmp->uninit.aux != NULL) {
+				info = slab_alloc (load_aux_slab);
+				if (info == NULL)
+					success = false;
+				else {
+        			memcpy(info, tmp->uninit.aux, sizeof(struct load_segment_aux));
+        			info->load.file = file_duplicate(info->load.file);
+				}
+			}
 
-        	vm_alloc_page_with_initializer(tmp->uninit.type, tmp->va, tmp->writable, tmp->uninit.init, (void *)info);
+        	if (success && !vm_alloc_page_with_initializer(tmp->uninit.type, tmp->va, tmp->writable, tmp->uninit.init, (void *)info))
+				success = false;
       	}
+		/* Pages of file mappings come back from the vmas as they are
+		 * used; text pages stand on their own. */
+		else if (tmp->vma == NULL)
+			success = file_backed_copy_text (tmp);
       	break;
     	case VM_ANON:
-      // printf("VMANON\n");
-      		vm_alloc_page(tmp->operations->type, tmp->va, tmp->writable);
-      		cpy = spt_find_page(dst, tmp->va);
-
-      // printf("child va : %p, type: %d\n", cpy->va, cpy->operations->type);
-
-      		if (cpy == NULL)
-      		{
-        		return false;
-      		}
-
-      		cpy->copy_writable = tmp->writable;
-      		struct frame *cpy_frame = malloc(sizeof(struct frame));
-      		cpy->frame = cpy_frame;
-      		cpy_frame->page = cpy;
-    
-      		cpy_frame->kva = tmp->frame->kva;
-
-      		struct thread *t = thread_current();
-      		lock_acquire(&lru_lock);
-      		list_push_back(&lru, &cpy_frame->lru_elem);
-      		lock_release(&lru_lock);
-
-      		if (pml4_set_page(t->pml4, cpy->va, cpy_frame->kva, 0) == false)
-      		{
-        // printf("child set page flase \n");
-        		return false;
-      		}
-      		swap_in(cpy, cpy_frame->kva);
-      		break;
     	case VM_FILE:
+			cpy = slab_alloc (page_slab);
+			if (cpy == NULL) {
+				success = false;
+				break;
+			}
+			*cpy = *tmp;
+			cpy->frame = NULL;
+			cpy->pml4 = t->pml4;
+			cpy->next_share = NULL;
+			cpy->zero_mapped = false;
+			cpy->vma = NULL;
+			if (is_anon (tmp)) {
+				cpy->anon.thread = t;
+				cpy->anon.slot = SWAP_SLOT_NONE;
+			} else if (tmp->vma != NULL) {
+				cpy->file.page = cpy;
+				vma_add_page (vma_find (dst, tmp->va), cpy);
+				cpy->file.file = cpy->vma->file;
+			} else {
+				/* A text page, with a file of its own. */
+				cpy->file.page = cpy;
+				cpy->file.file = file_duplicate (tmp->file.file);
+			}
+			spt_insert_page (dst, cpy);
+			success = page_share (cpy, tmp);
       		break;
     	default:
       		break;
     }
   }
-  return true;
+
+  vm_stats.forks++;
+  vm_stats.fork_ticks += timer_elapsed (start);
+  return success;
 }
 
 //vm 추가 함수
@@ -410,6 +1583,56 @@ supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 	 * TODO: writeback all the modified contents to the storage. */
 	lock_acquire(&kill_lock);
   	hash_destroy(&(spt->spt), spt_destroy_func);
+  	vma_destroy (spt);
   	lock_release(&kill_lock);
 
+	/* The page table goes next and may be handed to another process. */
+	if (policy->forget != NULL && thread_current ()->pml4 != NULL) {
+		lock_acquire (&frame_lock);
+		policy->forget (thread_current ()->pml4);
+		lock_release (&frame_lock);
+	}
+
+}
+
+/* Prints paging statistics. */
+void
+vm_print_stats (void) {
+	printf ("Paging: policy %s, %llu faults, %zu frames resident, "
+			"%llu samples\n", policy->name, vm_stats.faults, frame_cnt,
+			vm_stats.samples);
+	printf ("Paging: %llu swap-ins, %llu swap-outs, %llu failed evictions\n",
+			vm_stats.swap_ins, vm_stats.evictions, vm_stats.evict_failures);
+	printf ("Paging: %llu zero-page maps, %llu zero-page copies, "
+			"%zu peak frames resident\n", vm_stats.zero_maps,
+			vm_stats.zero_copies, vm_stats.peak_frames);
+	if (vm_stats.forks > 0)
+		printf ("Paging: %llu forks in %lld ticks, %llu frames shared; "
+				"%llu copied on write, %llu reused\n",
+				vm_stats.forks, vm_stats.fork_ticks, vm_stats.fork_shares,
+				vm_stats.cow_copies, vm_stats.cow_reuses);
+	if (vm_stats.file_loads > 0)
+		printf ("Paging: %llu file pages loaded in %llu reads, %llu of them "
+				"by fault-around in %llu faults\n", vm_stats.file_loads,
+				vm_stats.file_reads, vm_stats.around_pages,
+				vm_stats.around_faults);
+	if (vm_stats.drops > 0)
+		printf ("Paging: %llu mapped pages released on advice\n",
+				vm_stats.drops);
+	if (vm_stats.large_maps + vm_stats.large_fallbacks > 0)
+		printf ("Paging: %llu 2 MB regions mapped with superpages, "
+				"%llu without\n", vm_stats.large_maps,
+				vm_stats.large_fallbacks);
+	if (vm_stats.wb_pages + vm_stats.sync_pages > 0)
+		printf ("Paging: %llu dirty file pages written back in %llu passes, "
+				"%llu by msync\n", vm_stats.wb_pages, vm_stats.wb_passes,
+				vm_stats.sync_pages);
+	if (vm_stats.cache_maps > 0)
+		printf ("Paging: %llu faults mapped a frame of the page cache\n",
+				vm_stats.cache_maps);
+	vma_print_stats ();
+	file_backed_print_stats ();
+	page_cache_print_stats ();
+	policy->print_stats ();
+	swap_print_stats ();
 }
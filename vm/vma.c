@@ -0,0 +1,173 @@
+/* vma.c: Virtual memory areas.
+ *
+ * Each process keeps its areas in an array sorted by address.  They
+ * do not overlap, so a binary search on their end addresses finds
+ * the one holding an address, or the first one after it, in
+ * O(log n) steps however large the areas are.  Adding or removing an
+ * area shifts the ones after it, but a process has few areas. */
+
+#include "vm/vma.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "vm/vm.h"
+
+/* Area statistics. */
+static struct {
+	size_t regions;                 /* Areas in all processes. */
+	size_t peak;                    /* Maximum of REGIONS. */
+	unsigned long long pages;       /* Pages created in areas. */
+} vma_stats;
+
+/* Initializes the areas of SPT: none. */
+void
+vma_init (struct supplemental_page_table *spt) {
+	spt->vmas = NULL;
+	spt->vma_cnt = spt->vma_cap = 0;
+}
+
+/* Returns a new, empty area, or a null pointer if out of memory. */
+struct vma *
+vma_alloc (void) {
+	struct vma *vma = slab_alloc (vma_slab);
+	if (vma != NULL) {
+		memset (vma, 0, sizeof *vma);
+		list_init (&vma->pages);
+	}
+	return vma;
+}
+
+/* Frees VMA, which must not be in any process. */
+void
+vma_free (struct vma *vma) {
+	slab_free (vma_slab, vma);
+}
+
+/* Returns the index of the first area of SPT that ends after VA. */
+static size_t
+vma_index (struct supplemental_page_table *spt, const void *va) {
+	size_t lo = 0, hi = spt->vma_cnt;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if ((const uint8_t *) va < spt->vmas[mid]->end)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/* Returns the area of SPT that contains VA, or a null pointer. */
+struct vma *
+vma_find (struct supplemental_page_table *spt, const void *va) {
+	size_t i = vma_index (spt, va);
+
+	if (i < spt->vma_cnt && spt->vmas[i]->start <= (const uint8_t *) va)
+		return spt->vmas[i];
+	return NULL;
+}
+
+/* Returns true if any area of SPT overlaps [START, END). */
+bool
+vma_overlaps (struct supplemental_page_table *spt, const void *start,
+		const void *end) {
+	size_t i = vma_index (spt, start);
+	return i < spt->vma_cnt && spt->vmas[i]->start < (const uint8_t *) end;
+}
+
+/* Adds VMA, which must not overlap any area, to SPT.  Returns false
+ * if out of memory. */
+bool
+vma_insert (struct supplemental_page_table *spt, struct vma *vma) {
+	size_t i;
+
+	ASSERT (!vma_overlaps (spt, vma->start, vma->end));
+	if (spt->vma_cnt == spt->vma_cap) {
+		size_t cap = spt->vma_cap ? spt->vma_cap * 2 : 8;
+		struct vma **vmas = realloc (spt->vmas, cap * sizeof *vmas);
+		if (vmas == NULL)
+			return false;
+		spt->vmas = vmas;
+		spt->vma_cap = cap;
+	}
+	i = vma_index (spt, vma->start);
+	memmove (spt->vmas + i + 1, spt->vmas + i,
+			(spt->vma_cnt - i) * sizeof *spt->vmas);
+	spt->vmas[i] = vma;
+	spt->vma_cnt++;
+	if (++vma_stats.regions > vma_stats.peak)
+		vma_stats.peak = vma_stats.regions;
+	return true;
+}
+
+/* Removes VMA from SPT. */
+void
+vma_remove (struct supplemental_page_table *spt, struct vma *vma) {
+	size_t i = vma_index (spt, vma->start);
+
+	ASSERT (i < spt->vma_cnt && spt->vmas[i] == vma);
+	memmove (spt->vmas + i, spt->vmas + i + 1,
+			(spt->vma_cnt - i - 1) * sizeof *spt->vmas);
+	spt->vma_cnt--;
+	vma_stats.regions--;
+}
+
+/* Records that PAGE, just created, belongs to VMA. */
+void
+vma_add_page (struct vma *vma, struct page *page) {
+	page->vma = vma;
+	list_push_back (&vma->pages, &page->vma_elem);
+	vma_stats.pages++;
+}
+
+/* Gives DST, which has no areas, a copy of each area of SRC, each
+ * with a duplicate of its file but none of its pages.  Returns false
+ * if out of memory. */
+bool
+vma_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	size_t i;
+
+	for (i = 0; i < src->vma_cnt; i++) {
+		struct vma *vma = vma_alloc ();
+
+		if (vma == NULL)
+			return false;
+		*vma = *src->vmas[i];
+		list_init (&vma->pages);
+		vma->file = file_duplicate (vma->file);
+		if (vma->file == NULL || !vma_insert (dst, vma)) {
+			if (vma->file != NULL)
+				file_close (vma->file);
+			vma_free (vma);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Closes and frees every area of SPT, whose pages must be gone. */
+void
+vma_destroy (struct supplemental_page_table *spt) {
+	size_t i;
+
+	for (i = 0; i < spt->vma_cnt; i++) {
+		file_close (spt->vmas[i]->file);
+		vma_free (spt->vmas[i]);
+	}
+	vma_stats.regions -= spt->vma_cnt;
+	free (spt->vmas);
+	vma_init (spt);
+}
+
+/* Prints area statistics. */
+void
+vma_print_stats (void) {
+	if (vma_stats.peak > 0)
+		printf ("VMA: %zu areas, %zu peak, %llu pages created in them\n",
+				vma_stats.regions, vma_stats.peak, vma_stats.pages);
+}
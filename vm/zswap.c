@@ -0,0 +1,397 @@
+/* zswap.c: Compressed in-memory cache in front of the swap disk.
+ *
+ * A page on its way to swap is first offered to this pool.  Pages
+ * that consist of one repeated 64-bit word (most often zeros) are
+ * kept as just that word; other pages are compressed with a small
+ * LZ77 coder and kept if they shrink to at most ZSWAP_MAX_LEN
+ * bytes.  A page kept here is not written to disk, and faulting it
+ * back in is a decompression instead of a disk read.
+ *
+ * Entries are keyed by the swap slot that swap_alloc() set aside
+ * for the page, so the slot stays the page's only handle wherever
+ * the data lives.  When the pool grows past zswap_percent of the
+ * user pool, the oldest entries are decompressed and written to
+ * their slots on disk.
+ *
+ * ZSWAP_LOCK protects everything here and is held across the disk
+ * writes that spill entries, so that a page is always either in
+ * the pool or on disk from the point of view of zswap_load(). */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+
+/* Pages that do not compress to this many bytes go to disk. */
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+
+unsigned zswap_percent = 20;
+
+/* A page held in the pool. */
+struct zswap_entry {
+	size_t slot;                /* Swap slot reserved for the page. */
+	size_t len;                 /* Compressed length, 0 if same-filled. */
+	uint64_t fill;              /* Repeated word, if same-filled. */
+	uint8_t *data;              /* Compressed data, if LEN > 0. */
+	struct hash_elem hash_elem; /* Element in ENTRIES. */
+	struct list_elem lru_elem;  /* Element in LRU, oldest first. */
+};
+
+static struct hash entries;
+static struct list lru;
+static struct lock zswap_lock;
+static size_t pool_bytes;           /* Memory held by the pool. */
+static size_t pool_max;             /* Spill threshold for POOL_BYTES. */
+static uint8_t *scratch;            /* Page for compression and spills. */
+
+/* Pool statistics. */
+static struct {
+	unsigned long long stores;          /* Pages accepted. */
+	unsigned long long same_filled;     /* ...of which same-filled. */
+	unsigned long long rejects;         /* Pages that did not compress. */
+	unsigned long long loads;           /* Pages faulted back from the pool. */
+	unsigned long long spills;          /* Entries written to disk. */
+	unsigned long long bytes_in;        /* Page bytes accepted. */
+	unsigned long long bytes_out;       /* Compressed bytes kept for them. */
+} zswap_stats;
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_max);
+static bool lz_decompress (const uint8_t *src, size_t src_len, uint8_t *dst);
+
+static uint64_t
+entry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct zswap_entry *z = hash_entry (e, struct zswap_entry, hash_elem);
+	return hash_bytes (&z->slot, sizeof z->slot);
+}
+
+static bool
+entry_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct zswap_entry, hash_elem)->slot
+		< hash_entry (b, struct zswap_entry, hash_elem)->slot;
+}
+
+/* Returns the entry for SLOT, or a null pointer. */
+static struct zswap_entry *
+entry_find (size_t slot) {
+	struct zswap_entry key;
+	struct hash_elem *e;
+
+	key.slot = slot;
+	e = hash_find (&entries, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct zswap_entry, hash_elem) : NULL;
+}
+
+/* Removes Z from the pool and frees it. */
+static void
+entry_remove (struct zswap_entry *z) {
+	hash_delete (&entries, &z->hash_elem);
+	list_remove (&z->lru_elem);
+	pool_bytes -= sizeof *z + z->len;
+	free (z->data);
+	free (z);
+}
+
+/* Reconstructs the page held in Z at KVA. */
+static void
+entry_read (const struct zswap_entry *z, void *kva) {
+	if (z->len == 0) {
+		uint64_t *w = kva;
+		size_t i;
+
+		for (i = 0; i < PGSIZE / sizeof *w; i++)
+			w[i] = z->fill;
+	} else if (!lz_decompress (z->data, z->len, kva))
+		PANIC ("zswap: corrupt entry for slot %zu", z->slot);
+}
+
+/* Initializes the pool. */
+void
+zswap_init (void) {
+	hash_init (&entries, entry_hash, entry_less, NULL);
+	list_init (&lru);
+	lock_init (&zswap_lock);
+	pool_max = palloc_user_pages () / 100 * zswap_percent * PGSIZE;
+	if (zswap_percent > 0) {
+		scratch = palloc_get_page (0);
+		if (scratch == NULL)
+			PANIC ("zswap: out of memory");
+	}
+}
+
+/* Offers the page at KVA, destined for swap slot SLOT, to the
+ * pool.  Returns true if the pool took it, in which case it need
+ * not be written to disk. */
+bool
+zswap_store (size_t slot, const void *kva) {
+	const uint64_t *w = kva;
+	struct zswap_entry *z;
+	size_t i;
+
+	if (zswap_percent == 0)
+		return false;
+
+	z = malloc (sizeof *z);
+	if (z == NULL)
+		return false;
+	z->slot = slot;
+	z->len = 0;
+	z->fill = w[0];
+	z->data = NULL;
+
+	lock_acquire (&zswap_lock);
+	for (i = 1; i < PGSIZE / sizeof *w; i++)
+		if (w[i] != z->fill)
+			break;
+	if (i < PGSIZE / sizeof *w) {
+		z->len = lz_compress (kva, scratch, ZSWAP_MAX_LEN);
+		if (z->len > 0)
+			z->data = malloc (z->len);
+		if (z->data == NULL) {
+			zswap_stats.rejects++;
+			lock_release (&zswap_lock);
+			free (z);
+			return false;
+		}
+		memcpy (z->data, scratch, z->len);
+	} else
+		zswap_stats.same_filled++;
+
+	ASSERT (entry_find (slot) == NULL);
+	hash_insert (&entries, &z->hash_elem);
+	list_push_back (&lru, &z->lru_elem);
+	pool_bytes += sizeof *z + z->len;
+	zswap_stats.stores++;
+	zswap_stats.bytes_in += PGSIZE;
+	zswap_stats.bytes_out += z->len;
+
+	/* Spill the oldest entries, never the one just stored. */
+	while (pool_bytes > pool_max && list_front (&lru) != &z->lru_elem) {
+		struct zswap_entry *old = list_entry (list_front (&lru),
+				struct zswap_entry, lru_elem);
+		const void *page = scratch;
+
+		entry_read (old, scratch);
+		swap_write_disk (old->slot, &page, 1);
+		entry_remove (old);
+		zswap_stats.spills++;
+	}
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* If the page for swap slot SLOT is in the pool, copies it to KVA
+ * and returns true.  The entry stays until zswap_invalidate(). */
+bool
+zswap_load (size_t slot, void *kva) {
+	struct zswap_entry *z;
+
+	if (zswap_percent == 0)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	z = entry_find (slot);
+	if (z != NULL) {
+		entry_read (z, kva);
+		zswap_stats.loads++;
+	}
+	lock_release (&zswap_lock);
+	return z != NULL;
+}
+
+/* Drops the pool's copy of swap slot SLOT, if any. */
+void
+zswap_invalidate (size_t slot) {
+	struct zswap_entry *z;
+
+	if (zswap_percent == 0)
+		return;
+
+	lock_acquire (&zswap_lock);
+	z = entry_find (slot);
+	if (z != NULL)
+		entry_remove (z);
+	lock_release (&zswap_lock);
+}
+
+/* Prints pool statistics. */
+void
+zswap_print_stats (void) {
+	if (zswap_percent == 0)
+		return;
+	printf ("Zswap: %llu stored (%llu same-filled), %llu rejected, "
+			"%llu loaded, %llu spilled\n", zswap_stats.stores,
+			zswap_stats.same_filled, zswap_stats.rejects, zswap_stats.loads,
+			zswap_stats.spills);
+	printf ("Zswap: %zu entries in %zu of %zu bytes, "
+			"compression ratio %llu%%\n", hash_size (&entries), pool_bytes,
+			pool_max, zswap_stats.bytes_in > 0
+			? zswap_stats.bytes_out * 100 / zswap_stats.bytes_in : 0);
+}
+
+/* LZ77 coding, in the block format of LZ4.
+ *
+ * The output is a series of sequences, each a token byte, a run of
+ * literal bytes and a back-reference.  The high nibble of the
+ * token is the literal count and the low nibble the match length
+ * minus 4; a nibble of 15 is continued by bytes that are added to
+ * it, up to and including the first byte below 255.  The
+ * back-reference is a 2-byte little-endian offset.  The last
+ * sequence has literals only. */
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+
+/* Page offsets of recently seen 4-byte strings, by hash. */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static inline uint32_t
+lz_load32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+static inline size_t
+lz_hash (uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes extended length N at OP and returns the new OP. */
+static uint8_t *
+lz_put_len (uint8_t *op, size_t n) {
+	for (; n >= 255; n -= 255)
+		*op++ = 255;
+	*op++ = n;
+	return op;
+}
+
+/* Appends a sequence of LIT_LEN literals at LIT followed, if
+ * MATCH_LEN is nonzero, by a match of MATCH_LEN bytes at OFFSET
+ * back.  Returns false if that would pass OEND. */
+static bool
+lz_emit (uint8_t **opp, uint8_t *oend, const uint8_t *lit, size_t lit_len,
+		size_t offset, size_t match_len) {
+	uint8_t *op = *opp;
+	uint8_t *token;
+	size_t ml = match_len - LZ_MIN_MATCH;
+
+	if ((size_t) (oend - op) < 1 + lit_len / 255 + 1 + lit_len
+			+ 2 + (match_len > 0 ? ml / 255 + 1 : 0))
+		return false;
+
+	token = op++;
+	*token = (lit_len < 15 ? lit_len : 15) << 4;
+	if (lit_len >= 15)
+		op = lz_put_len (op, lit_len - 15);
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+
+	if (match_len > 0) {
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		*token |= ml < 15 ? ml : 15;
+		if (ml >= 15)
+			op = lz_put_len (op, ml - 15);
+	}
+	*opp = op;
+	return true;
+}
+
+/* Compresses the page at SRC into DST.  Returns the compressed
+ * length, or 0 if it would exceed DST_MAX bytes. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_max) {
+	const uint8_t *ip = src, *anchor = src, *end = src + PGSIZE;
+	uint8_t *op = dst, *oend = dst + dst_max;
+
+	memset (lz_table, 0, sizeof lz_table);
+	while (ip + LZ_MIN_MATCH <= end) {
+		uint32_t seq = lz_load32 (ip);
+		size_t h = lz_hash (seq);
+		const uint8_t *ref = src + lz_table[h];
+		const uint8_t *mp, *rp;
+
+		lz_table[h] = ip - src;
+		if (ref >= ip || lz_load32 (ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		for (mp = ip + LZ_MIN_MATCH, rp = ref + LZ_MIN_MATCH;
+				mp < end && *mp == *rp; mp++, rp++)
+			continue;
+		if (!lz_emit (&op, oend, anchor, ip - anchor, ip - ref, mp - ip))
+			return 0;
+		ip = anchor = mp;
+	}
+	if (!lz_emit (&op, oend, anchor, end - anchor, 0, 0))
+		return 0;
+	return op - dst;
+}
+
+/* Reads an extended length at *IPP, not reading past IEND. */
+static size_t
+lz_get_len (const uint8_t **ipp, const uint8_t *iend) {
+	const uint8_t *ip = *ipp;
+	size_t n = 0;
+
+	while (ip < iend) {
+		uint8_t b = *ip++;
+		n += b;
+		if (b != 255)
+			break;
+	}
+	*ipp = ip;
+	return n;
+}
+
+/* Decompresses SRC_LEN bytes at SRC into the page at DST.  Returns
+ * false if SRC is not a well-formed encoding of a whole page. */
+static bool
+lz_decompress (const uint8_t *src, size_t src_len, uint8_t *dst) {
+	const uint8_t *ip = src, *iend = src + src_len;
+	uint8_t *op = dst, *oend = dst + PGSIZE;
+
+	while (ip < iend) {
+		unsigned token = *ip++;
+		size_t len = token >> 4;
+		size_t offset;
+		const uint8_t *ref;
+
+		if (len == 15)
+			len += lz_get_len (&ip, iend);
+		if (len > (size_t) (iend - ip) || len > (size_t) (oend - op))
+			return false;
+		memcpy (op, ip, len);
+		op += len;
+		ip += len;
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return false;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		len = token & 15;
+		if (len == 15)
+			len += lz_get_len (&ip, iend);
+		len += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| len > (size_t) (oend - op))
+			return false;
+
+		/* The match may overlap its own output. */
+		for (ref = op - offset; len > 0; len--)
+			*op++ = *ref++;
+	}
+	return op == oend;
+}